@@ -0,0 +1,107 @@
+/*
+*	FILE:					chat-capture.h
+*	ASSIGNMENT:		The "Can We Talk?" System
+*	PROGRAMMERS:	Quang Minh Vu
+*	DESCRIPTION:	This file holds the binary traffic capture format written by the server
+*								and read by the replay tool. A capture is the 8 byte magic followed by
+*								records, each a packed captureRecord and then len bytes of payload
+*								(the peer address for an open, the raw bytes read for data).
+*								All fields are in host byte order.
+*/
+
+#ifndef CHAT_CAPTURE_H
+#define CHAT_CAPTURE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CAPTURE_MAGIC     "CHATCAP1"
+#define CAPTURE_MAGIC_LEN 8
+
+enum { CAPTURE_OPEN = 1, CAPTURE_DATA = 2, CAPTURE_CLOSE = 3 };
+
+typedef struct __attribute__((packed)) {
+    uint8_t  type;
+    uint32_t conn;      /* connection number, unique within a capture */
+    uint64_t timeNs;    /* nanoseconds since the capture started */
+    uint16_t len;       /* payload bytes that follow */
+} captureRecord;
+
+//==================================================FUNCTION========================|
+//Name:					captureWriteHeader 																									|
+//Params:				FILE*	file	The capture file, opened for writing.									|
+//Returns:			int					0 on success, -1 on a write error.									|
+//Outputs:			The capture magic.																									|
+//Description:	This function starts a new capture file.														| 
+//==================================================================================|
+static inline int captureWriteHeader(FILE *file)
+{
+    return fwrite(CAPTURE_MAGIC, 1, CAPTURE_MAGIC_LEN, file) == CAPTURE_MAGIC_LEN ? 0 : -1;
+}
+
+//==================================================FUNCTION========================|
+//Name:					captureWrite 																												|
+//Params:				FILE*			file		The capture file.															|
+//							int				type		CAPTURE_OPEN, CAPTURE_DATA or CAPTURE_CLOSE.	|
+//							uint32_t	conn		The connection number.												|
+//							uint64_t	timeNs	Nanoseconds since the capture started.				|
+//							void*			data		The payload, or NULL.													|
+//							size_t		len			The payload length.														|
+//Returns:			NONE 																																|
+//Outputs:			One record.																													|
+//Description:	This function appends a record. The file is locked for the whole		| 
+//							record, so several threads can share one capture.									|
+//==================================================================================|
+static inline void captureWrite(FILE *file, int type, uint32_t conn, uint64_t timeNs,
+                                const void *data, size_t len)
+{
+    captureRecord record;
+
+    if (len > UINT16_MAX) len = UINT16_MAX;
+    record.type = (uint8_t)type;
+    record.conn = conn;
+    record.timeNs = timeNs;
+    record.len = (uint16_t)len;
+
+    flockfile(file);
+    fwrite(&record, sizeof(record), 1, file);
+    if (len > 0) fwrite(data, 1, len, file);
+    funlockfile(file);
+}
+
+//==================================================FUNCTION========================|
+//Name:					captureReadHeader 																									|
+//Params:				FILE*	file	The capture file, opened for reading.									|
+//Returns:			int					0 if the file is a capture, -1 otherwise.						|
+//Outputs:			NONE																																|
+//Description:	This function checks the capture magic.															| 
+//==================================================================================|
+static inline int captureReadHeader(FILE *file)
+{
+    char magic[CAPTURE_MAGIC_LEN];
+
+    if (fread(magic, 1, CAPTURE_MAGIC_LEN, file) != CAPTURE_MAGIC_LEN) return -1;
+    return memcmp(magic, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN) == 0 ? 0 : -1;
+}
+
+//==================================================FUNCTION========================|
+//Name:					captureRead 																												|
+//Params:				FILE*						file		The capture file.												|
+//							captureRecord*	record	Where to store the record.							|
+//							char*						data		Where to store the payload.							|
+//							size_t					size		The size of data (at least UINT16_MAX + 1).|
+//Returns:			int							1 for a record, 0 at the end, -1 if truncated.		|
+//Outputs:			NONE																																|
+//Description:	This function reads the next record. The payload is NUL terminated.	| 
+//==================================================================================|
+static inline int captureRead(FILE *file, captureRecord *record, char *data, size_t size)
+{
+    if (fread(record, sizeof(*record), 1, file) != 1) return feof(file) ? 0 : -1;
+    if (record->len >= size) return -1;
+    if (record->len > 0 && fread(data, 1, record->len, file) != record->len) return -1;
+    data[record->len] = '\0';
+    return 1;
+}
+
+#endif
@@ -0,0 +1,152 @@
+/*
+*	FILE:					chat-ring.h
+*	ASSIGNMENT:		The "Can We Talk?" System
+*	PROGRAMMERS:	Quang Minh Vu
+*	DESCRIPTION:	This file holds the shared-memory broadcast ring used by co-located consumers.
+*								The server is the single producer and one consumer attaches per ring, so the
+*								data path is plain loads and stores with no system calls.
+*/
+
+#ifndef CHAT_RING_H
+#define CHAT_RING_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define RING_MAGIC      0x43524E47u     /* "CRNG" */
+#define RING_SLOTS      1024            /* must be a power of two */
+#define RING_FRAME_SIZE 256
+#define RING_CACHE_LINE 64
+
+typedef struct {
+    uint32_t len;
+    char     data[RING_FRAME_SIZE - sizeof(uint32_t)];
+} ringFrame;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t slots;
+    _Alignas(RING_CACHE_LINE) _Atomic uint64_t head;      /* next frame to publish, producer only */
+    _Alignas(RING_CACHE_LINE) _Atomic uint64_t tail;      /* next frame to read, consumer only */
+    _Alignas(RING_CACHE_LINE) _Atomic uint64_t dropped;   /* frames lost because the ring was full */
+    ringFrame frames[RING_SLOTS];
+} chatRing;
+
+//==================================================FUNCTION========================|
+//Name:					ringCreate 																													|
+//Params:				char*	name	The POSIX shared-memory name, e.g. "/chat-ring".			|
+//Returns:			chatRing*		The mapped, empty ring or NULL on failure.					|
+//Outputs:			NONE																																|
+//Description:	This function creates (or resets) the ring on the producer side.		| 
+//==================================================================================|
+static inline chatRing *ringCreate(const char *name)
+{
+    chatRing *ring;
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+
+    if (fd < 0) return NULL;
+    if (ftruncate(fd, sizeof(chatRing)) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    ring = mmap(NULL, sizeof(chatRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED) return NULL;
+
+    ring->slots = RING_SLOTS;
+    atomic_store(&ring->head, 0);
+    atomic_store(&ring->tail, 0);
+    atomic_store(&ring->dropped, 0);
+    atomic_thread_fence(memory_order_release);
+    ring->magic = RING_MAGIC;
+    return ring;
+}
+
+//==================================================FUNCTION========================|
+//Name:					ringAttach 																													|
+//Params:				char*	name	The POSIX shared-memory name the server was given.		|
+//Returns:			chatRing*		The mapped ring or NULL if it is missing or invalid.|
+//Outputs:			NONE																																|
+//Description:	This function maps an existing ring on the consumer side.						| 
+//==================================================================================|
+static inline chatRing *ringAttach(const char *name)
+{
+    chatRing *ring;
+    int fd = shm_open(name, O_RDWR, 0);
+
+    if (fd < 0) return NULL;
+    ring = mmap(NULL, sizeof(chatRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED) return NULL;
+
+    if (ring->magic != RING_MAGIC || ring->slots != RING_SLOTS) {
+        munmap(ring, sizeof(chatRing));
+        return NULL;
+    }
+    return ring;
+}
+
+//==================================================FUNCTION========================|
+//Name:					ringPublish 																												|
+//Params:				chatRing*	ring	The ring to publish into.											|
+//							char*			msg		The frame to publish.													|
+//							size_t		len		The length of the frame.											|
+//Returns:			int						0 on success, -1 if the ring was full.						|
+//Outputs:			NONE																																|
+//Description:	This function copies one frame into the ring. A full ring drops the	| 
+//							frame and counts it rather than stalling the broadcaster.					|
+//==================================================================================|
+static inline int ringPublish(chatRing *ring, const char *msg, size_t len)
+{
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    ringFrame *frame;
+
+    if (head - tail >= RING_SLOTS) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return -1;
+    }
+
+    if (len > sizeof(frame->data)) len = sizeof(frame->data);
+    frame = &ring->frames[head & (RING_SLOTS - 1)];
+    memcpy(frame->data, msg, len);
+    frame->len = (uint32_t)len;
+
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return 0;
+}
+
+//==================================================FUNCTION========================|
+//Name:					ringRead 																														|
+//Params:				chatRing*	ring	The ring to read from.												|
+//							char*			buf		The buffer to copy the frame into.						|
+//							size_t		size	The size of the buffer.												|
+//Returns:			int						The frame length, or 0 if the ring is empty.			|
+//Outputs:			NONE																																|
+//Description:	This function takes the oldest frame out of the ring. Frames longer	| 
+//							than the buffer are truncated.																		|
+//==================================================================================|
+static inline int ringRead(chatRing *ring, char *buf, size_t size)
+{
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    ringFrame *frame;
+    size_t len;
+
+    if (tail == head) return 0;
+
+    frame = &ring->frames[tail & (RING_SLOTS - 1)];
+    len = frame->len < size ? frame->len : size;
+    memcpy(buf, frame->data, len);
+
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return (int)len;
+}
+
+#endif
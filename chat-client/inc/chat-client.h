@@ -6,6 +6,7 @@
 #include <sys/types.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
@@ -14,9 +15,17 @@
 #include <ncurses.h>
 #include <pthread.h>
 #include <time.h>
+#include <poll.h>
+#include <errno.h>
 
 #define PORT 5000
 #define MAX_LINES 10
+#define HEARTBEAT_PING ">>ping<<"
+#define HEARTBEAT_PONG ">>pong<<"
+#define MCAST_SUBSCRIBE ">>subscribe<<"
+#define MCAST_WINDOW 1024
+#define MCAST_EARLY 64
+#define MCAST_PACKET_SIZE 256
 
 WINDOW *create_newwin(int, int, int, int, int);
 WINDOW *msg_win;
@@ -27,5 +36,10 @@ void destroy_win(WINDOW *win);
 void blankWin(WINDOW *win);
 void init_color_pair();
 void *receive_messages(void *arg);
+void show_message(char *text);
+void join_multicast(int sock, char *offer);
+void receive_sequenced(int sock, char *packet, int repaired);
+char *find_repair(char *line);
+int receive_stream(int sock);
 void add_to_history(char *message);
 extern WINDOW *msg_win;
\ No newline at end of file
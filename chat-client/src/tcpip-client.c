@@ -13,11 +13,20 @@ char clientName[6];
 char message_history[MAX_LINES][BUFSIZ];
 int history_count = 0;
 pthread_mutex_t history_mutex = PTHREAD_MUTEX_INITIALIZER;
+int mcast_sock = -1;
+unsigned int mcast_conn = 0;
+unsigned int mcast_first = 0;
+unsigned int mcast_next = 0;
+int mcast_ready = 0;
+unsigned int mcast_seen[MCAST_WINDOW];
+char mcast_early[MCAST_EARLY][MCAST_PACKET_SIZE];
+int mcast_early_count = 0;
 
 int main(int argc, char *argv[])
 {
     int my_server_socket, len, done;
     struct sockaddr_in server_addr;
+    struct sockaddr_un unix_addr;
     struct hostent *host;
     char message[128];
     char userID[128];
@@ -25,7 +34,7 @@ int main(int argc, char *argv[])
 
     if (argc != 3)
     {
-        printf("USAGE : %s -user<userID> -server<serverName>\n", argv[0]);
+        printf("USAGE : %s -user<userID> -server<serverName or /unix/socket/path>\n", argv[0]);
         return 1;
     }
 
@@ -56,28 +65,51 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    if ((host = gethostbyname(serverName)) == NULL)
+    // A server name that is a path means a server on this host, reached over AF_UNIX
+    if (serverName[0] == '/')
     {
-        printf("ERROR: Host not found.\n");
-        return 2;
-    }
+        memset(&unix_addr, 0, sizeof(unix_addr));
+        unix_addr.sun_family = AF_UNIX;
+        strncpy(unix_addr.sun_path, serverName, sizeof(unix_addr.sun_path) - 1);
 
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    memcpy(&server_addr.sin_addr, host->h_addr, host->h_length);
-    server_addr.sin_port = htons(PORT);
+        if ((my_server_socket = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        {
+            printf("ERROR: Could not create socket.\n");
+            return 3;
+        }
 
-    if ((my_server_socket = socket(AF_INET, SOCK_STREAM, 0)) < 0)
-    {
-        printf("ERROR: Could not create socket.\n");
-        return 3;
+        if (connect(my_server_socket, (struct sockaddr *)&unix_addr, sizeof(unix_addr)) < 0)
+        {
+            printf("ERROR: Could not connect to server.\n");
+            close(my_server_socket);
+            return 4;
+        }
     }
-
-    if (connect(my_server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
+    else
     {
-        printf("ERROR: Could not connect to server.\n");
-        close(my_server_socket);
-        return 4;
+        if ((host = gethostbyname(serverName)) == NULL)
+        {
+            printf("ERROR: Host not found.\n");
+            return 2;
+        }
+
+        memset(&server_addr, 0, sizeof(server_addr));
+        server_addr.sin_family = AF_INET;
+        memcpy(&server_addr.sin_addr, host->h_addr, host->h_length);
+        server_addr.sin_port = htons(PORT);
+
+        if ((my_server_socket = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+        {
+            printf("ERROR: Could not create socket.\n");
+            return 3;
+        }
+
+        if (connect(my_server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
+        {
+            printf("ERROR: Could not connect to server.\n");
+            close(my_server_socket);
+            return 4;
+        }
     }
 
     WINDOW *chat_win;
@@ -159,6 +191,8 @@ int main(int argc, char *argv[])
     pthread_cancel(recv_thread);
     pthread_join(recv_thread, NULL);
     pthread_mutex_destroy(&history_mutex);
+    if (mcast_sock >= 0)
+        close(mcast_sock);
     destroy_win(chat_win);
     destroy_win(msg_win);
     endwin();
@@ -371,83 +405,320 @@ void add_to_history(char *message)
     pthread_mutex_unlock(&history_mutex);
 }
 
+//==================================================FUNCTION========================|
+//Name: show_message |
+//Params: char *text A message line as formatted by the server. |
+//Returns: NONE |
+//Outputs: NONE |
+//Description: This function parses a server message and adds it to the display. |
+//==================================================================================|
+void show_message(char *text)
+{
+    char formatted_msg[BUFSIZ];
+    char ip[16] = "";
+    char user[6] = "";
+    char msg_content[81] = "";
+    char timestamp[10] = "";
+    
+    char *ptr = text;
+    char *space = strchr(ptr, ' ');
+    
+    if (!space) {
+        return;
+    }
+    
+    int ip_len = space - ptr;
+    if (ip_len >= 16) ip_len = 15;
+    strncpy(ip, ptr, ip_len);
+    ip[ip_len] = '\0';
+    
+    ptr = space + 1;
+    char *bracket_open = strchr(ptr, '[');
+    char *bracket_close = strchr(ptr, ']');
+    
+    if (!bracket_open || !bracket_close || bracket_close <= bracket_open) {
+        return;
+    }
+    
+    int user_len = bracket_close - bracket_open - 1;
+    if (user_len >= 6) user_len = 5;
+    strncpy(user, bracket_open + 1, user_len);
+    user[user_len] = '\0';
+    
+    char *msg_marker = strstr(bracket_close, ">>");
+    if (!msg_marker) {
+        return;
+    }
+    
+    ptr = msg_marker + 3;
+    char *timestamp_ptr = strrchr(text, ' ');
+    
+    if (!timestamp_ptr || timestamp_ptr <= ptr) {
+        return;
+    }
+    
+    strncpy(timestamp, timestamp_ptr + 1, 8);
+    timestamp[8] = '\0';
+    
+    int msg_len = timestamp_ptr - ptr;
+    if (msg_len > 80) msg_len = 80;
+    strncpy(msg_content, ptr, msg_len);
+    msg_content[msg_len] = '\0';
+    
+    snprintf(formatted_msg, BUFSIZ,
+            "%-15s [%-5s] >> %-40s %s",
+            ip, user, msg_content, timestamp);
+    
+    add_to_history(formatted_msg);
+}
+
+//==================================================FUNCTION========================|
+//Name: join_multicast |
+//Params: int sock The TCP connection to the server. |
+// char *offer The server's ">>mcast <group> <port> <connID>" offer. |
+//Returns: NONE |
+//Outputs: NONE |
+//Description: This function joins the server's multicast group and subscribes. If the|
+// group cannot be joined, broadcasts simply keep arriving over TCP. |
+//==================================================================================|
+void join_multicast(int sock, char *offer)
+{
+    struct sockaddr_in group_addr;
+    struct ip_mreq membership;
+    char group[16];
+    int port, opt = 1;
+    unsigned int conn;
+
+    if (mcast_sock >= 0 || sscanf(offer, ">>mcast %15s %d %u", group, &port, &conn) != 3)
+        return;
+
+    memset(&group_addr, 0, sizeof(group_addr));
+    group_addr.sin_family = AF_INET;
+    group_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    group_addr.sin_port = htons(port);
+
+    if (inet_pton(AF_INET, group, &membership.imr_multiaddr) != 1)
+        return;
+    membership.imr_interface.s_addr = htonl(INADDR_ANY);
+
+    int udp = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udp < 0)
+        return;
+
+    if (setsockopt(udp, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+        bind(udp, (struct sockaddr *)&group_addr, sizeof(group_addr)) < 0 ||
+        setsockopt(udp, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0)
+    {
+        close(udp);
+        return;
+    }
+
+    mcast_sock = udp;
+    mcast_conn = conn;
+    write(sock, MCAST_SUBSCRIBE, strlen(MCAST_SUBSCRIBE));
+}
+
+//==================================================FUNCTION========================|
+//Name: receive_sequenced |
+//Params: int sock The TCP connection, used to ask for repairs. |
+// char *packet A "#<seq> <sender> <message>" multicast frame. |
+// int repaired 1 if the frame is a repair sent over TCP. |
+//Returns: NONE |
+//Outputs: NONE |
+//Description: This function shows each sequenced frame once, skipping this client's|
+// own messages, and asks the server to resend any gap it finds. |
+// Frames that beat the subscription reply are held until it comes. |
+// The server's ">>seq <next><<" announcement exposes a lost last frame. |
+//==================================================================================|
+void receive_sequenced(int sock, char *packet, int repaired)
+{
+    unsigned int seq, sender;
+    int offset = 0;
+    char request[64];
+
+    if (sscanf(packet, ">>seq %u<<", &seq) == 1)
+    {
+        if (mcast_ready && seq > mcast_next)
+        {
+            snprintf(request, sizeof(request), ">>resend %u %u<<", mcast_next, seq - 1);
+            write(sock, request, strlen(request));
+            mcast_next = seq;
+        }
+        return;
+    }
+
+    if (sscanf(packet, "#%u %u %n", &seq, &sender, &offset) != 2 || offset == 0)
+        return;
+
+    if (!mcast_ready)
+    {
+        if (mcast_early_count < MCAST_EARLY)
+        {
+            strncpy(mcast_early[mcast_early_count], packet, MCAST_PACKET_SIZE - 1);
+            mcast_early[mcast_early_count++][MCAST_PACKET_SIZE - 1] = '\0';
+        }
+        return;
+    }
+
+    // Older frames came over TCP before the subscription took effect
+    if (seq < mcast_first || mcast_seen[seq % MCAST_WINDOW] == seq + 1)
+        return;
+    mcast_seen[seq % MCAST_WINDOW] = seq + 1;
+
+    if (!repaired && seq > mcast_next)
+    {
+        snprintf(request, sizeof(request), ">>resend %u %u<<", mcast_next, seq - 1);
+        write(sock, request, strlen(request));
+    }
+    if (seq >= mcast_next)
+        mcast_next = seq + 1;
+
+    if (sender != mcast_conn)
+        show_message(packet + offset);
+}
+
+//==================================================FUNCTION========================|
+//Name: receive_stream |
+//Params: int sock The TCP connection to the server. |
+//Returns: int 0 once the read is handled, -1 if the server closed. |
+//Outputs: NONE |
+//Description: This function handles one read from the server: it answers heartbeat|
+// pings, takes the multicast offer and subscription reply, feeds |
+// repaired frames to receive_sequenced and shows everything else. |
+//==================================================================================|
+int receive_stream(int sock)
+{
+    char recv_buf[BUFSIZ];
+
+    memset(recv_buf, 0, BUFSIZ);
+    int len = read(sock, recv_buf, BUFSIZ - 1);
+    
+    if (len <= 0)
+        return -1;
+
+    // Answer the server's heartbeat and drop it from whatever arrived with it
+    char *ping;
+    while ((ping = strstr(recv_buf, HEARTBEAT_PING)) != NULL)
+    {
+        write(sock, HEARTBEAT_PONG, strlen(HEARTBEAT_PONG));
+        memmove(ping, ping + strlen(HEARTBEAT_PING), strlen(ping + strlen(HEARTBEAT_PING)) + 1);
+    }
+
+    // Multicast control messages come first in whatever they arrived with
+    char *rest = recv_buf;
+    while (strncmp(rest, ">>mcast ", 8) == 0 || strncmp(rest, ">>subscribed ", 13) == 0)
+    {
+        char *end = strstr(rest, "<<");
+        if (!end)
+            break;
+        *end = '\0';
+
+        if (rest[2] == 'm')
+        {
+            join_multicast(sock, rest);
+        }
+        else if (sscanf(rest, ">>subscribed %u", &mcast_first) == 1)
+        {
+            mcast_next = mcast_first;
+            mcast_ready = 1;
+
+            // Datagrams that arrived before the reply can be placed now
+            for (int i = 0; i < mcast_early_count; i++)
+                receive_sequenced(sock, mcast_early[i], 0);
+            mcast_early_count = 0;
+        }
+        rest = end + 2;
+    }
+
+    // Repaired frames each end in a newline, but may share the read, or even
+    // the line, with an echo or broadcast that came before them
+    char *line = rest, *end;
+    while ((end = strchr(line, '\n')) != NULL)
+    {
+        *end = '\0';
+        char *frame = find_repair(line);
+        if (frame && frame > line)
+        {
+            *frame = '\0';
+            show_message(line);
+            *frame = '#';
+        }
+        if (frame)
+            receive_sequenced(sock, frame, 1);
+        else if (strlen(line) > 0)
+            show_message(line);
+        line = end + 1;
+    }
+
+    if (strlen(line) > 0)
+        show_message(line);
+    return 0;
+}
+
+//==================================================FUNCTION========================|
+//Name: find_repair |
+//Params: char *line One newline-terminated line of a read, without the newline. |
+//Returns: char* The start of the "#<seq> <sender> " frame in it, or NULL. |
+//Outputs: NONE |
+//Description: This function finds a repaired frame wherever it starts in a line, |
+// so one glued onto the end of an echo is still placed. |
+//==================================================================================|
+char *find_repair(char *line)
+{
+    unsigned int seq, sender;
+    int offset;
+
+    for (char *hash = strchr(line, '#'); hash; hash = strchr(hash + 1, '#'))
+    {
+        offset = 0;
+        if (sscanf(hash, "#%u %u %n", &seq, &sender, &offset) == 2 && offset > 0)
+            return hash;
+    }
+    return NULL;
+}
+
 //==================================================FUNCTION========================|
 //Name: receive_messages |
 //Params: void *arg The socket to receive the message from. |
 //Returns: NONE |
 //Outputs: NONE |
 //Description: This function handles receiving messages from the server, parsing, and displaying them.|
+// It also answers the server's heartbeat pings and, when the server offers|
+// multicast, receives broadcasts from the group instead of over TCP. |
 //==================================================================================|
 void *receive_messages(void *arg)
 {
     int sock = *((int *)arg);
     char recv_buf[BUFSIZ];
-    char formatted_msg[BUFSIZ];
+    struct pollfd pfds[2];
+    int nfds;
     
     while (1)
     {
-        memset(recv_buf, 0, BUFSIZ);
-        int len = read(sock, recv_buf, BUFSIZ);
-        
-        if (len <= 0)
+        pfds[0].fd = sock;
+        pfds[0].events = POLLIN;
+        pfds[1].fd = mcast_sock;
+        pfds[1].events = POLLIN;
+        nfds = mcast_sock >= 0 ? 2 : 1;
+
+        if (poll(pfds, nfds, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
             break;
-        
-        char ip[16] = "";
-        char user[6] = "";
-        char msg_content[81] = "";
-        char timestamp[10] = "";
-        
-        char *ptr = recv_buf;
-        char *space = strchr(ptr, ' ');
-        
-        if (!space) {
-            continue;
         }
-        
-        int ip_len = space - ptr;
-        if (ip_len >= 16) ip_len = 15;
-        strncpy(ip, ptr, ip_len);
-        ip[ip_len] = '\0';
-        
-        ptr = space + 1;
-        char *bracket_open = strchr(ptr, '[');
-        char *bracket_close = strchr(ptr, ']');
-        
-        if (!bracket_open || !bracket_close || bracket_close <= bracket_open) {
-            continue;
-        }
-        
-        int user_len = bracket_close - bracket_open - 1;
-        if (user_len >= 6) user_len = 5;
-        strncpy(user, bracket_open + 1, user_len);
-        user[user_len] = '\0';
-        
-        char *msg_marker = strstr(bracket_close, ">>");
-        if (!msg_marker) {
-            continue;
-        }
-        
-        ptr = msg_marker + 3;
-        char *timestamp_ptr = strrchr(recv_buf, ' ');
-        
-        if (!timestamp_ptr || timestamp_ptr <= ptr) {
-            continue;
+
+        // TCP first: it carries the subscription reply the datagrams depend on
+        if (pfds[0].revents != 0 && receive_stream(sock) < 0)
+            break;
+
+        if (nfds == 2 && (pfds[1].revents & POLLIN))
+        {
+            memset(recv_buf, 0, BUFSIZ);
+            if (recv(mcast_sock, recv_buf, BUFSIZ - 1, 0) > 0)
+                receive_sequenced(sock, recv_buf, 0);
         }
-        
-        strncpy(timestamp, timestamp_ptr + 1, 8);
-        timestamp[8] = '\0';
-        
-        int msg_len = timestamp_ptr - ptr;
-        if (msg_len > 80) msg_len = 80;
-        strncpy(msg_content, ptr, msg_len);
-        msg_content[msg_len] = '\0';
-        
-        snprintf(formatted_msg, BUFSIZ,
-                "%-15s [%-5s] >> %-40s %s",
-                ip, user, msg_content, timestamp);
-        
-        add_to_history(formatted_msg);
     }
     
     pthread_exit(NULL);
-}
\ No newline at end of file
+}
@@ -0,0 +1,14 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <limits.h>
+#include <time.h>
+#include <sched.h>
+#include "../../Common/inc/chat-ring.h"
+
+#define LOGGER_SPIN_LIMIT 1000
+#define LOGGER_IDLE_US 1000
+
+void logFrames(chatRing *ring, FILE *out);
@@ -0,0 +1,127 @@
+/*
+*	FILE:					ring-logger.c
+*	ASSIGNMENT:		The "Can We Talk?" System
+*	PROGRAMMERS:	Quang Minh Vu
+*	DESCRIPTION:	This file is the co-located consumer of the server's shared-memory broadcast
+*								ring (tcpipServer -shm<name>). It archives every broadcast frame to stdout or
+*								a log file without a socket, and reports frames the ring had to drop.
+*/
+
+#include "../inc/chat-logger.h"
+
+//===GLOBALS===//
+volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int sig)
+{
+    (void)sig;
+    stopRequested = 1;
+}
+
+int main(int argc, char *argv[])
+{
+    //===VARIABLES===//
+    char             ringName[NAME_MAX] = "";
+    char             logPath[PATH_MAX] = "";
+    chatRing*        ring;
+    FILE*            out = stdout;
+    struct sigaction sa;
+    int              i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "-shm", 4) == 0)
+        {
+            strncpy(ringName, argv[i] + 4, sizeof(ringName) - 1);
+        }
+        else if (strncmp(argv[i], "-log", 4) == 0)
+        {
+            strncpy(logPath, argv[i] + 4, sizeof(logPath) - 1);
+        }
+    }
+
+    if (strlen(ringName) == 0)
+    {
+        printf("USAGE : %s -shm<name given to tcpipServer> [-log<file>]\n", argv[0]);
+        return 1;
+    }
+
+    if ((ring = ringAttach(ringName)) == NULL)
+    {
+        printf("ERROR: no broadcast ring named %s, is the server running with -shm?\n", ringName);
+        return 2;
+    }
+
+    if (strlen(logPath) > 0 && (out = fopen(logPath, "a")) == NULL)
+    {
+        printf("ERROR: cannot open %s.\n", logPath);
+        return 3;
+    }
+
+    // SIGINT and SIGTERM stop the logger so the last frames are flushed
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = requestStop;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    logFrames(ring, out);
+
+    fflush(out);
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    munmap(ring, sizeof(chatRing));
+    return 0;
+}
+
+//==================================================FUNCTION========================|
+//Name:					logFrames 																													|
+//Params:				chatRing*	ring	The attached broadcast ring.									|
+//							FILE*			out		Where each frame is written, one per line.		|
+//Returns:			NONE																																|
+//Outputs:			The broadcast frames, and a note on stderr when frames were dropped.|
+//Description:	This function drains the ring until asked to stop. While frames are	| 
+//							flowing it only touches shared memory; once the ring has been empty	|
+//							for LOGGER_SPIN_LIMIT polls it sleeps LOGGER_IDLE_US between polls.	|
+//==================================================================================|
+void logFrames(chatRing *ring, FILE *out)
+{
+    char     frame[RING_FRAME_SIZE];
+    uint64_t reported = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+    uint64_t dropped;
+    int      idleSpins = 0;
+    int      len;
+
+    while (!stopRequested)
+    {
+        if ((len = ringRead(ring, frame, sizeof(frame))) > 0)
+        {
+            fwrite(frame, 1, len, out);
+            fputc('\n', out);
+            idleSpins = 0;
+            continue;
+        }
+
+        // Empty: push out what was logged and check whether the server lost any
+        if (idleSpins == 0)
+        {
+            fflush(out);
+            dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+            if (dropped != reported)
+            {
+                fprintf(stderr, "ring dropped %llu frames\n", (unsigned long long)(dropped - reported));
+                reported = dropped;
+            }
+        }
+
+        if (++idleSpins < LOGGER_SPIN_LIMIT)
+        {
+            sched_yield();
+        }
+        else
+        {
+            usleep(LOGGER_IDLE_US);
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+#
+# FILE          : connect-burst.py
+# ASSIGNMENT    : Assignment 4
+# PROGRAMMERS   : Quang Minh Vu
+# DESCRIPTION   : Connection-storm benchmark for the accept path. It opens and
+#                 immediately closes connections at a target rate (10k/s by
+#                 default), then reports the achieved rate, connect latency and
+#                 failures, and checks that the server still relays a message.
+#
+# USAGE         : ./connect-burst.py [-server <ip|path>] [-rate <n>] [-seconds <n>]
+#
+
+import socket
+import sys
+import time
+
+PORT = 5000
+
+
+def open_conn(server):
+    if server.startswith("/"):
+        s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        s.settimeout(2)
+        s.connect(server)
+    else:
+        s = socket.create_connection((server, PORT), timeout=2)
+    return s
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p))]
+
+
+def main():
+    server, rate, seconds = "127.0.0.1", 10000, 1.0
+    args = sys.argv[1:]
+    while args:
+        flag = args.pop(0)
+        if flag == "-server" and args:
+            server = args.pop(0)
+        elif flag == "-rate" and args:
+            rate = int(args.pop(0))
+        elif flag == "-seconds" and args:
+            seconds = float(args.pop(0))
+        else:
+            print("usage: connect-burst.py [-server <ip|path>] [-rate <n>] [-seconds <n>]")
+            return 1
+
+    total = int(rate * seconds)
+    latencies = []
+    failures = 0
+    start = time.perf_counter()
+
+    for n in range(total):
+        # Pace against the schedule, not the previous connect, so a slow
+        # accept shows up as a lower achieved rate rather than being hidden
+        due = start + n / rate
+        now = time.perf_counter()
+        if due > now:
+            time.sleep(due - now)
+
+        t0 = time.perf_counter()
+        try:
+            open_conn(server).close()
+            latencies.append(time.perf_counter() - t0)
+        except OSError:
+            failures += 1
+
+    elapsed = time.perf_counter() - start
+    print("connects   %d in %.2fs (%.0f/s, target %d/s)" % (total, elapsed, total / elapsed, rate))
+    print("failures   %d" % failures)
+    print("latency    p50 %.0fus  p99 %.0fus  max %.0fus" % (
+        percentile(latencies, 0.50) * 1e6, percentile(latencies, 0.99) * 1e6,
+        max(latencies, default=0) * 1e6))
+
+    # The server must still be serving chat once the storm is over
+    time.sleep(0.5)
+    try:
+        a, b = open_conn(server), open_conn(server)
+        time.sleep(0.1)
+        a.sendall(b"[burst] >> after the storm")
+        a.recv(4096)
+        relayed = b"after the storm" in b.recv(4096)
+        a.close()
+        b.close()
+    except OSError:
+        relayed = False
+    print("relay      %s" % ("ok" if relayed else "FAILED"))
+
+    return 0 if relayed else 2
+
+
+if __name__ == "__main__":
+    sys.exit(main())
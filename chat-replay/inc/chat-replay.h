@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include "../../Common/inc/chat-capture.h"
+
+#define PORT 5000
+#define MAX_REPLAY_CONNS 256
+#define MAX_PENDING 64
+#define MATCH_LEN 64
+#define DRAIN_TIMEOUT_MS 2000
+#define ECHO_TIMEOUT_MS 1000
+#define HEARTBEAT_PING ">>ping<<"
+#define HEARTBEAT_PONG ">>pong<<"
+
+typedef struct {
+    uint32_t conn;
+    int      socket;                            /* -1 when the entry is free */
+    int      closing;                           /* our side is shut, reading until the server closes */
+    int      dropped;                           /* the server closed it before the capture did */
+    int      numPending;
+    uint64_t sentNs[MAX_PENDING];               /* send time of each unanswered message */
+    char     sentText[MAX_PENDING][MATCH_LEN];  /* its first bytes, to find the echo */
+} replayConn;
+
+typedef struct {
+    uint64_t connections;
+    uint64_t failedConnects;
+    uint64_t dropped;
+    uint64_t messages;
+    uint64_t bytes;
+    uint64_t answered;
+    uint64_t unanswered;
+    double   elapsed;
+    double   msgsPerSec;
+    double   p50Us;
+    double   p99Us;
+    double   maxUs;
+} replayResult;
+
+uint64_t nowNs(void);
+int connectServer(const char *serverName);
+replayConn *findConn(uint32_t conn);
+int echoText(const char *data, size_t len, char *text, size_t size);
+void sendData(replayConn *entry, const char *data, size_t len);
+void pumpReplies(int timeoutMs);
+void answerPings(int socket, char *chunk);
+void matchEchoes(replayConn *entry, char *chunk);
+void dropPending(replayConn *entry, int index);
+void expirePending(replayConn *entry, uint64_t now);
+void finishConn(replayConn *entry);
+void closeConn(replayConn *entry);
+int countOwed(void);
+void addLatency(uint64_t ns);
+void summarise(replayResult *result);
+void printResult(const replayResult *result, double speed);
+int saveResult(const char *path, const replayResult *result);
+void compareResult(const char *path, const replayResult *result);
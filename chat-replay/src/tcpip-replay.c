@@ -0,0 +1,707 @@
+/*
+*	FILE:					tcpip-replay.c
+*	ASSIGNMENT:		The "Can We Talk?" System
+*	PROGRAMMERS:	Quang Minh Vu
+*	DESCRIPTION:	This file replays a traffic capture recorded by tcpipServer -capture<file>
+*								against a running server at a chosen speed, and reports throughput and
+*								echo latency, optionally compared with a saved baseline run.
+*/
+
+#include "../inc/chat-replay.h"
+
+//===GLOBALS===//
+replayConn	conns[MAX_REPLAY_CONNS];
+char		serverName[128];
+replayResult result;
+uint64_t*	latencies = NULL;
+size_t		numLatencies = 0;
+size_t		maxLatencies = 0;
+
+int main(int argc, char *argv[])
+{
+    //===VARIABLES===//
+    char          capturePath[128] = "";
+    char          savePath[128] = "";
+    char          comparePath[128] = "";
+    static char   data[UINT16_MAX + 1];
+    double        speed = 1.0;
+    captureRecord record;
+    replayConn*   entry;
+    FILE*         capture;
+    uint64_t      start, target, now, sendEnd;
+    int           status, i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "-capture", 8) == 0)
+        {
+            strncpy(capturePath, argv[i] + 8, sizeof(capturePath) - 1);
+        }
+        else if (strncmp(argv[i], "-server", 7) == 0)
+        {
+            strncpy(serverName, argv[i] + 7, sizeof(serverName) - 1);
+        }
+        else if (strncmp(argv[i], "-speed", 6) == 0)
+        {
+            speed = atof(argv[i] + 6);
+        }
+        else if (strncmp(argv[i], "-save", 5) == 0)
+        {
+            strncpy(savePath, argv[i] + 5, sizeof(savePath) - 1);
+        }
+        else if (strncmp(argv[i], "-compare", 8) == 0)
+        {
+            strncpy(comparePath, argv[i] + 8, sizeof(comparePath) - 1);
+        }
+    }
+
+    if (strlen(capturePath) == 0 || strlen(serverName) == 0)
+    {
+        printf("USAGE : %s -capture<file> -server<serverName or /unix/socket/path> "
+               "[-speed<N, 0 = as fast as possible>] [-save<file>] [-compare<file>]\n", argv[0]);
+        return 1;
+    }
+
+    if ((capture = fopen(capturePath, "rb")) == NULL || captureReadHeader(capture) < 0)
+    {
+        printf("ERROR: %s is not a capture file.\n", capturePath);
+        return 2;
+    }
+
+    for (i = 0; i < MAX_REPLAY_CONNS; i++)
+    {
+        conns[i].socket = -1;
+    }
+
+    //===REPLAY LOOP===//
+    start = nowNs();
+    while ((status = captureRead(capture, &record, data, sizeof(data))) == 1)
+    {
+        // Hold each record back until its scaled capture time, reading replies meanwhile
+        if (speed > 0)
+        {
+            target = start + (uint64_t)(record.timeNs / speed);
+            while ((now = nowNs()) < target)
+            {
+                pumpReplies((int)((target - now + 999999) / 1000000));
+            }
+        }
+
+        entry = findConn(record.conn);
+
+        if (record.type == CAPTURE_OPEN)
+        {
+            if (entry != NULL)
+            {
+                finishConn(entry);
+                closeConn(entry);
+                entry->dropped = 0;
+            }
+            if ((entry = findConn(UINT32_MAX)) == NULL ||
+                (entry->socket = connectServer(serverName)) < 0)
+            {
+                result.failedConnects++;
+                continue;
+            }
+            entry->conn = record.conn;
+            entry->closing = 0;
+            entry->dropped = 0;
+            entry->numPending = 0;
+            result.connections++;
+        }
+        else if (record.type == CAPTURE_DATA && entry != NULL && !entry->closing)
+        {
+            sendData(entry, data, record.len);
+        }
+        else if (record.type == CAPTURE_CLOSE && entry != NULL)
+        {
+            // Keep reading its echoes in the background rather than waiting here
+            finishConn(entry);
+            entry->dropped = 0;
+        }
+    }
+    sendEnd = nowNs();
+
+    if (status < 0)
+    {
+        printf("WARNING: %s is truncated, replayed what was readable.\n", capturePath);
+    }
+
+    //===CLEANUP===//
+    // The tail of echoes is collected for latency, but not timed as throughput
+    for (i = 0; i < MAX_REPLAY_CONNS; i++)
+    {
+        finishConn(&conns[i]);
+    }
+    now = nowNs();
+    while (countOwed() > 0 && nowNs() - now < DRAIN_TIMEOUT_MS * 1000000ull)
+    {
+        pumpReplies(10);
+    }
+    for (i = 0; i < MAX_REPLAY_CONNS; i++)
+    {
+        closeConn(&conns[i]);
+    }
+    result.elapsed = (sendEnd - start) / 1e9;
+    fclose(capture);
+
+    summarise(&result);
+    printResult(&result, speed);
+
+    if (strlen(comparePath) > 0)
+    {
+        compareResult(comparePath, &result);
+    }
+
+    if (strlen(savePath) > 0 && saveResult(savePath, &result) < 0)
+    {
+        printf("ERROR: Could not save results to %s.\n", savePath);
+        return 3;
+    }
+
+    free(latencies);
+    return 0;
+}
+
+//==================================================FUNCTION========================|
+//Name:					nowNs 																															|
+//Params:				NONE																																|
+//Returns:			uint64_t		The monotonic clock in nanoseconds.										|
+//Outputs:			NONE																																|
+//Description:	This function reads the clock used for scheduling and latency.			| 
+//==================================================================================|
+uint64_t nowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+//==================================================FUNCTION========================|
+//Name:					connectServer 																											|
+//Params:				char*	serverName	A host name, or a path for the AF_UNIX listener.	|
+//Returns:			int						The connected socket, or -1 on failure.						|
+//Outputs:			NONE																																|
+//Description:	This function opens one replayed connection.												| 
+//==================================================================================|
+int connectServer(const char *serverName)
+{
+    struct sockaddr_in server_addr;
+    struct sockaddr_un unix_addr;
+    struct hostent *host;
+    int sock;
+
+    if (serverName[0] == '/')
+    {
+        memset(&unix_addr, 0, sizeof(unix_addr));
+        unix_addr.sun_family = AF_UNIX;
+        strncpy(unix_addr.sun_path, serverName, sizeof(unix_addr.sun_path) - 1);
+
+        if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) return -1;
+        if (connect(sock, (struct sockaddr *)&unix_addr, sizeof(unix_addr)) < 0)
+        {
+            close(sock);
+            return -1;
+        }
+        return sock;
+    }
+
+    if ((host = gethostbyname(serverName)) == NULL) return -1;
+
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    memcpy(&server_addr.sin_addr, host->h_addr, host->h_length);
+    server_addr.sin_port = htons(PORT);
+
+    if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0) return -1;
+    if (connect(sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
+    {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+//==================================================FUNCTION========================|
+//Name:					findConn 																														|
+//Params:				uint32_t	conn	The captured connection number, or UINT32_MAX.	|
+//Returns:			replayConn*		The open or dropped entry for conn, a free entry for	|
+//													UINT32_MAX, or NULL.														|
+//Outputs:			NONE																																|
+//Description:	This function maps a captured connection onto its replay socket.		| 
+//							A free entry is taken from the ones not remembering a dropped			|
+//							connection first, so that connection's data is still counted.			|
+//==================================================================================|
+replayConn *findConn(uint32_t conn)
+{
+    replayConn *reuse = NULL;
+
+    for (int i = 0; i < MAX_REPLAY_CONNS; i++)
+    {
+        if (conn != UINT32_MAX)
+        {
+            if ((conns[i].socket != -1 || conns[i].dropped) && conns[i].conn == conn) return &conns[i];
+        }
+        else if (conns[i].socket == -1)
+        {
+            if (!conns[i].dropped) return &conns[i];
+            if (reuse == NULL) reuse = &conns[i];
+        }
+    }
+    return reuse;
+}
+
+//==================================================FUNCTION========================|
+//Name:					sendData 																														|
+//Params:				replayConn*	entry	The connection to send on.									|
+//							char*				data	The captured bytes.													|
+//							size_t			len		The number of bytes.												|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function replays one read and remembers it so the echo can be	| 
+//							timed. The echo carries the raw input, so its first bytes find it.|
+//							Heartbeat and multicast control input is sent but never echoed,	|
+//							so it is neither counted as a message nor waited for. A message for	|
+//							a connection the server has dropped is counted as unanswered.			|
+//==================================================================================|
+void sendData(replayConn *entry, const char *data, size_t len)
+{
+    char text[MATCH_LEN];
+    int echoed = echoText(data, len, text, sizeof(text));
+
+    if (entry->socket != -1 && send(entry->socket, data, len, MSG_NOSIGNAL) != (ssize_t)len)
+    {
+        closeConn(entry);
+    }
+
+    if (entry->socket == -1)
+    {
+        if (echoed > 0)
+        {
+            result.messages++;
+            result.unanswered++;
+        }
+        return;
+    }
+    result.bytes += len;
+
+    if (echoed == 0)
+    {
+        return;
+    }
+    result.messages++;
+
+    if (entry->numPending == MAX_PENDING)
+    {
+        // Too far behind to keep timing this connection; count the oldest as lost
+        dropPending(entry, 0);
+        result.unanswered++;
+    }
+
+    entry->sentNs[entry->numPending] = nowNs();
+    strcpy(entry->sentText[entry->numPending], text);
+    entry->numPending++;
+}
+
+//==================================================FUNCTION========================|
+//Name:					echoText 																														|
+//Params:				char*		data	The captured bytes.															|
+//							size_t	len		The number of bytes.														|
+//							char*		text	Where the start of the expected echo is written.|
+//							size_t	size	The size of text.																|
+//Returns:			int						The length of text, 0 if the server will not echo.|
+//Outputs:			NONE																																|
+//Description:	This function works out what the server echoes for one read. The		| 
+//							server strips heartbeat and multicast control tokens wherever they	|
+//							appear, closes on a lone ">>bye<<" and drops empty input.					|
+//==================================================================================|
+int echoText(const char *data, size_t len, char *text, size_t size)
+{
+    static const char *tokens[] = { ">>pong<<", ">>subscribe<<", ">>resend " };
+    size_t out = 0, i = 0, t, skip;
+    const char *end;
+
+    while (i < len && data[i] != '\0' && out < size - 1)
+    {
+        skip = 0;
+        for (t = 0; t < sizeof(tokens) / sizeof(tokens[0]) && skip == 0; t++)
+        {
+            if (strncmp(data + i, tokens[t], strlen(tokens[t])) != 0) continue;
+
+            skip = strlen(tokens[t]);
+            if (t == 2)
+            {
+                // ">>resend <from> <to><<" runs to its closing marker
+                end = strstr(data + i, "<<");
+                skip = end != NULL ? (size_t)(end + 2 - (data + i)) : len - i;
+            }
+        }
+
+        if (skip > 0)
+        {
+            i += skip;
+        }
+        else
+        {
+            text[out++] = data[i++];
+        }
+    }
+    text[out] = '\0';
+
+    if (strcmp(text, ">>bye<<") == 0) return 0;
+    return (int)out;
+}
+
+//==================================================FUNCTION========================|
+//Name:					pumpReplies 																												|
+//Params:				int	timeoutMs	The longest time to wait for a reply.							|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function reads whatever the server has sent on every replayed	| 
+//							connection, answers its heartbeats and matches echoes against the	|
+//							messages sent. Messages left without an echo for ECHO_TIMEOUT_MS	|
+//							are given up on.																									|
+//==================================================================================|
+void pumpReplies(int timeoutMs)
+{
+    struct pollfd pfds[MAX_REPLAY_CONNS];
+    replayConn *owners[MAX_REPLAY_CONNS];
+    char chunk[BUFSIZ];
+    uint64_t now;
+    int count = 0, ready, len;
+
+    for (int i = 0; i < MAX_REPLAY_CONNS; i++)
+    {
+        if (conns[i].socket != -1)
+        {
+            pfds[count].fd = conns[i].socket;
+            pfds[count].events = POLLIN;
+            owners[count++] = &conns[i];
+        }
+    }
+
+    if (count == 0)
+    {
+        if (timeoutMs > 0) usleep(timeoutMs * 1000);
+        return;
+    }
+
+    ready = poll(pfds, count, timeoutMs);
+
+    for (int i = 0; i < count && ready > 0; i++)
+    {
+        if (pfds[i].revents == 0) continue;
+        ready--;
+
+        len = read(pfds[i].fd, chunk, sizeof(chunk) - 1);
+        if (len <= 0)
+        {
+            closeConn(owners[i]);
+            continue;
+        }
+        chunk[len] = '\0';
+        answerPings(pfds[i].fd, chunk);
+        matchEchoes(owners[i], chunk);
+    }
+
+    now = nowNs();
+    for (int i = 0; i < count; i++)
+    {
+        expirePending(owners[i], now);
+    }
+}
+
+//==================================================FUNCTION========================|
+//Name:					answerPings 																												|
+//Params:				int		socket	The connection the chunk arrived on.								|
+//							char*	chunk		The bytes read from the server.									|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function answers every heartbeat in the chunk, as the client		| 
+//							does, so a quiet stretch of the capture is not cut short by the		|
+//							server's idle timeout. The pings are removed before matching.			|
+//==================================================================================|
+void answerPings(int socket, char *chunk)
+{
+    char *ping;
+
+    while ((ping = strstr(chunk, HEARTBEAT_PING)) != NULL)
+    {
+        send(socket, HEARTBEAT_PONG, strlen(HEARTBEAT_PONG), MSG_NOSIGNAL);
+        memmove(ping, ping + strlen(HEARTBEAT_PING), strlen(ping + strlen(HEARTBEAT_PING)) + 1);
+    }
+}
+
+//==================================================FUNCTION========================|
+//Name:					matchEchoes 																												|
+//Params:				replayConn*	entry	The connection the chunk arrived on.				|
+//							char*				chunk	The bytes read from the server.							|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function records the latency of every pending message whose		| 
+//							echo is in the chunk, oldest first, so one message that never comes	|
+//							back does not hold up the rest. A matched echo is blanked out of		|
+//							the chunk, so repeated identical messages match one echo each.		|
+//							Broadcasts are ignored.																						|
+//==================================================================================|
+void matchEchoes(replayConn *entry, char *chunk)
+{
+    uint64_t now = nowNs();
+    char *found;
+    int i = 0;
+
+    while (i < entry->numPending)
+    {
+        if ((found = strstr(chunk, entry->sentText[i])) == NULL)
+        {
+            i++;
+            continue;
+        }
+
+        addLatency(now - entry->sentNs[i]);
+        found[0] = '\1';
+        dropPending(entry, i);
+    }
+}
+
+//==================================================FUNCTION========================|
+//Name:					dropPending 																												|
+//Params:				replayConn*	entry	The connection.															|
+//							int					index	The pending message to forget.							|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function removes one pending message, keeping the rest in the	| 
+//							order they were sent.																							|
+//==================================================================================|
+void dropPending(replayConn *entry, int index)
+{
+    int after = entry->numPending - index - 1;
+
+    memmove(&entry->sentNs[index], &entry->sentNs[index + 1], after * sizeof(uint64_t));
+    memmove(entry->sentText[index], entry->sentText[index + 1], after * MATCH_LEN);
+    entry->numPending--;
+}
+
+//==================================================FUNCTION========================|
+//Name:					expirePending 																											|
+//Params:				replayConn*	entry	The connection.															|
+//							uint64_t		now		The current time in nanoseconds.						|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function counts messages unanswered after ECHO_TIMEOUT_MS as		| 
+//							lost. Pending messages are in send order, so it stops at the first	|
+//							one still within the timeout.																			|
+//==================================================================================|
+void expirePending(replayConn *entry, uint64_t now)
+{
+    while (entry->numPending > 0 && now - entry->sentNs[0] > ECHO_TIMEOUT_MS * 1000000ull)
+    {
+        dropPending(entry, 0);
+        result.unanswered++;
+    }
+}
+
+//==================================================FUNCTION========================|
+//Name:					finishConn 																													|
+//Params:				replayConn*	entry	The connection the capture closed.					|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function shuts down the sending side, as the captured client		| 
+//							did. The server still sends what it owes before closing, and			|
+//							pumpReplies keeps reading it until then without holding up the		|
+//							schedule.																													|
+//==================================================================================|
+void finishConn(replayConn *entry)
+{
+    if (entry->socket == -1 || entry->closing) return;
+
+    shutdown(entry->socket, SHUT_WR);
+    entry->closing = 1;
+}
+
+//==================================================FUNCTION========================|
+//Name:					countOwed 																														|
+//Params:				NONE																																|
+//Returns:			int						The number of connections still owed echoes.		|
+//Outputs:			NONE																																|
+//Description:	This function tells the final drain whether to keep reading.				| 
+//==================================================================================|
+int countOwed(void)
+{
+    int owed = 0;
+
+    for (int i = 0; i < MAX_REPLAY_CONNS; i++)
+    {
+        if (conns[i].socket != -1 && conns[i].numPending > 0) owed++;
+    }
+    return owed;
+}
+
+//==================================================FUNCTION========================|
+//Name:					closeConn 																													|
+//Params:				replayConn*	entry	The connection to close.										|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function closes a replayed connection and frees its entry.			| 
+//							One the server closed before the capture did is remembered as			|
+//							dropped, so the data still captured for it is counted.						|
+//==================================================================================|
+void closeConn(replayConn *entry)
+{
+    if (entry->socket == -1) return;
+
+    if (!entry->closing)
+    {
+        entry->dropped = 1;
+        result.dropped++;
+    }
+    result.unanswered += entry->numPending;
+    entry->numPending = 0;
+    close(entry->socket);
+    entry->socket = -1;
+}
+
+//==================================================FUNCTION========================|
+//Name:					addLatency 																													|
+//Params:				uint64_t	ns		The echo latency of one message.							|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function stores a latency sample for the percentiles.					| 
+//==================================================================================|
+void addLatency(uint64_t ns)
+{
+    if (numLatencies == maxLatencies)
+    {
+        size_t grown = maxLatencies ? maxLatencies * 2 : 4096;
+        uint64_t *bigger = realloc(latencies, grown * sizeof(uint64_t));
+        if (bigger == NULL) return;
+        latencies = bigger;
+        maxLatencies = grown;
+    }
+
+    latencies[numLatencies++] = ns;
+    result.answered++;
+}
+
+static int compareLatency(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+//==================================================FUNCTION========================|
+//Name:					summarise 																													|
+//Params:				replayResult*	result	The run to finish.												|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function computes the throughput and latency percentiles.			| 
+//==================================================================================|
+void summarise(replayResult *result)
+{
+    result->msgsPerSec = result->elapsed > 0 ? result->messages / result->elapsed : 0;
+
+    if (numLatencies == 0) return;
+
+    qsort(latencies, numLatencies, sizeof(uint64_t), compareLatency);
+    result->p50Us = latencies[numLatencies / 2] / 1e3;
+    result->p99Us = latencies[(numLatencies * 99) / 100] / 1e3;
+    result->maxUs = latencies[numLatencies - 1] / 1e3;
+}
+
+//==================================================FUNCTION========================|
+//Name:					printResult 																												|
+//Params:				replayResult*	result	The finished run.													|
+//							double				speed		The replay speed, 0 for as fast as possible.|
+//Returns:			NONE 																																|
+//Outputs:			The run's summary on stdout.																				|
+//Description:	This function reports the replay.																		| 
+//==================================================================================|
+void printResult(const replayResult *result, double speed)
+{
+    char speedText[32];
+
+    if (speed > 0) snprintf(speedText, sizeof(speedText), "%gx", speed);
+    else strcpy(speedText, "full speed");
+
+    printf("replayed %llu messages (%llu bytes) on %llu connections in %.3f s at %s\n",
+           (unsigned long long)result->messages, (unsigned long long)result->bytes,
+           (unsigned long long)result->connections, result->elapsed, speedText);
+    if (result->failedConnects > 0)
+    {
+        printf("failed connects: %llu\n", (unsigned long long)result->failedConnects);
+    }
+    if (result->dropped > 0)
+    {
+        printf("dropped by server: %llu\n", (unsigned long long)result->dropped);
+    }
+    printf("throughput:   %.1f msgs/s\n", result->msgsPerSec);
+    printf("echo latency: p50 %.0f us, p99 %.0f us, max %.0f us (%llu answered, %llu unanswered)\n",
+           result->p50Us, result->p99Us, result->maxUs,
+           (unsigned long long)result->answered, (unsigned long long)result->unanswered);
+}
+
+//==================================================FUNCTION========================|
+//Name:					saveResult 																													|
+//Params:				char*					path		The file to write.												|
+//							replayResult*	result	The finished run.													|
+//Returns:			int						0 on success, -1 if the file could not be written.	|
+//Outputs:			One "key value" line per metric.																		|
+//Description:	This function saves a run to be used later as a -compare baseline.	| 
+//==================================================================================|
+int saveResult(const char *path, const replayResult *result)
+{
+    FILE *file = fopen(path, "w");
+
+    if (file == NULL) return -1;
+    fprintf(file, "msgs_per_sec %f\n", result->msgsPerSec);
+    fprintf(file, "p50_us %f\n", result->p50Us);
+    fprintf(file, "p99_us %f\n", result->p99Us);
+    fprintf(file, "max_us %f\n", result->maxUs);
+    fprintf(file, "unanswered %llu\n", (unsigned long long)result->unanswered);
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+//==================================================FUNCTION========================|
+//Name:					compareResult 																											|
+//Params:				char*					path		A file written by -save.									|
+//							replayResult*	result	The finished run.													|
+//Returns:			NONE 																																|
+//Outputs:			Each metric's change from the baseline on stdout.										|
+//Description:	This function reports the deltas that reveal a regression.					| 
+//==================================================================================|
+void compareResult(const char *path, const replayResult *result)
+{
+    FILE *file = fopen(path, "r");
+    char key[32];
+    double baseline, current;
+
+    if (file == NULL)
+    {
+        printf("WARNING: Could not read baseline %s.\n", path);
+        return;
+    }
+
+    printf("compared with %s:\n", path);
+    while (fscanf(file, "%31s %lf", key, &baseline) == 2)
+    {
+        if (strcmp(key, "msgs_per_sec") == 0) current = result->msgsPerSec;
+        else if (strcmp(key, "p50_us") == 0) current = result->p50Us;
+        else if (strcmp(key, "p99_us") == 0) current = result->p99Us;
+        else if (strcmp(key, "max_us") == 0) current = result->maxUs;
+        else if (strcmp(key, "unanswered") == 0) current = result->unanswered;
+        else continue;
+
+        if (baseline != 0)
+        {
+            printf("  %-12s %12.1f -> %12.1f (%+.1f%%)\n", key, baseline, current,
+                   (current - baseline) * 100.0 / baseline);
+        }
+        else
+        {
+            printf("  %-12s %12.1f -> %12.1f\n", key, baseline, current);
+        }
+    }
+    fclose(file);
+}
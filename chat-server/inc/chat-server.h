@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
@@ -6,6 +7,7 @@
 #include <sys/types.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
@@ -13,17 +15,91 @@
 #include <sys/wait.h>
 #include <fcntl.h>
 #include <pthread.h>
+#include <poll.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <stddef.h>
+#include "../../Common/inc/chat-ring.h"
+#include "../../Common/inc/chat-capture.h"
 
 #define PORT 5000
+#define UNIX_SOCKET_PATH "/tmp/chat-server.sock"
+#define MAX_CLIENTS 10
+#define ACCEPT_BATCH 32
+#define ACCEPT_BACKOFF_MS 100
+#define OUTBOUND_SIZE 65536
+#define IDLE_TIMEOUT_SEC 90
+#define HEARTBEAT_PING ">>ping<<"
+#define HEARTBEAT_PONG ">>pong<<"
+#define MULTICAST_PORT 5001
+#define MCAST_HISTORY 1024
+#define MCAST_MAX_REPAIR 64
+#define MCAST_SUBSCRIBE ">>subscribe<<"
+#define MCAST_RESEND ">>resend "
+#define MCAST_ANNOUNCE_MS 1000
+#define MCAST_NONE UINT32_MAX
+
+#include "timer-wheel.h"
 
 typedef struct {
-    int     socket;
-    char    ip[16];
+    int       socket;
+    char      ip[INET_ADDRSTRLEN];
+    char      buffer[BUFSIZ];
+    char      userID[6];
+    int       gotID;
+    uint32_t  connID;
+    timerNode timer;                    /* ingest-owned heartbeat/idle deadline */
+    uint64_t  lastActive;               /* tick of the client's last traffic */
+    int       pingSent;
+    _Atomic uint32_t mcastFrom;         /* first frame sent to it by multicast, MCAST_NONE on TCP */
+    pthread_mutex_t outLock;            /* guards the outbound queue below */
+    char      outBuf[OUTBOUND_SIZE];    /* bytes the socket has not taken yet */
+    size_t    outHead;
+    size_t    outLen;
+    int       outArmed;                 /* ingest is watching for EPOLLOUT */
 } userInfo;
 
-void *socketThread(void *);
+#include "pipeline.h"
+#include "client-registry.h"
+
+typedef struct {
+    uint32_t  seq;
+    uint32_t  sender;                   /* connID of the client that sent it */
+    char      frame[PIPE_FRAME_SIZE];
+} mcastFrame;
+
+void *ingestStage(void *);
+uint64_t currentTick(void);
+void ingestClose(userInfo *slot);
+void admitClients(void);
+void expireIdle(void);
+int takeControl(userInfo *slot, int lane);
+int stripToken(char *buffer, const char *token);
+void *parseStage(void *);
+void *formatStage(void *);
+void *fanoutStage(void *);
+int startPipeline(int lanes);
+pipeEvent *stageReserve(spscQueue *q);
+void stageBackoff(int *idleSpins);
+void stageIdle(spscQueue *in[], int numIn, int *idleSpins);
+void pinThread(pthread_t tid, int cpu);
+void printStageStats(void);
 void initializeArray(void);
 void initializeServerAddress(struct sockaddr_in server_addr);
-void updateArray(int client_socket);
-void writeToClients(int clSocket, char message[]);
+userInfo *updateArray(int client_socket, const char *ip);
+void releaseSlot(userInfo *slot);
+int acceptBatch(int server_socket);
+int openUnixListener(const char *path);
+int queueClient(userInfo *slot, int socket, const char *data, size_t len);
+void flushClient(userInfo *slot);
+void writeToClients(int clSocket, char message[], uint32_t seq);
+int openMulticast(const char *group);
+uint32_t mcastPublish(userInfo *sender, const char *frame);
+void mcastRepair(userInfo *slot, uint32_t from, uint32_t to);
+void mcastAnnounce(void);
 int parcelMessage(char* original, char* parceled[], int maxParcels);
\ No newline at end of file
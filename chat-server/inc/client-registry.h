@@ -0,0 +1,35 @@
+/*
+*	FILE:					client-registry.h
+*	ASSIGNMENT:		The "Can We Talk?" System
+*	PROGRAMMERS:	Quang Minh Vu
+*	DESCRIPTION:	This file holds the epoch-protected snapshot of connected clients that
+*								broadcasters walk without taking userList_mutex.
+*/
+
+#ifndef CLIENT_REGISTRY_H
+#define CLIENT_REGISTRY_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define MAX_READERS  32
+#define MAX_RETIRED  64
+
+typedef struct {
+    int       count;
+    userInfo* members[MAX_CLIENTS];
+    int       sockets[MAX_CLIENTS];     /* copied, so a reader never sees a slot mid-release */
+} memberSet;
+
+typedef struct {
+    _Alignas(64) _Atomic uint64_t epoch;  /* 0 while outside a read section */
+} readerRecord;
+
+int registryInit(void);
+const memberSet *registryEnter(void);
+void registryExit(void);
+void registryAdd(userInfo *slots[], int count);
+void registryRemove(userInfo *slot);
+void registrySynchronize(void);
+
+#endif
@@ -0,0 +1,188 @@
+/*
+*	FILE:					pipeline.h
+*	ASSIGNMENT:		The "Can We Talk?" System
+*	PROGRAMMERS:	Quang Minh Vu
+*	DESCRIPTION:	This file holds the event type and the bounded single-producer/single-consumer
+*								queues that connect the stages of the server's processing pipeline
+*								(ingest -> parse -> format -> fan-out).
+*/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#define MAX_LANES        8
+#define MAX_PARCELS      3
+#define PIPE_QUEUE_SIZE  256            /* must be a power of two */
+#define PIPE_BATCH       32
+#define PIPE_TEXT_SIZE   256
+#define PIPE_FRAME_SIZE  128
+#define PIPE_CACHE_LINE  64
+#define PIPE_SPIN_LIMIT  1000
+#define PIPE_IDLE_US     100            /* backoff while a downstream queue is full */
+
+enum { EVENT_MESSAGE, EVENT_CLOSE, EVENT_PING, EVENT_OPEN,
+       EVENT_ANNOUNCE, EVENT_SUBSCRIBE, EVENT_RESEND };
+
+typedef struct {
+    int       type;
+    userInfo* slot;
+    int       numFrames;
+    uint32_t  seqFrom;                                /* EVENT_RESEND: multicast range to repair */
+    uint32_t  seqTo;
+    char      text[PIPE_TEXT_SIZE];                   /* raw input, then the sender's echo */
+    char      frames[MAX_PARCELS][PIPE_FRAME_SIZE];   /* broadcast frames for the other clients */
+} pipeEvent;
+
+typedef struct {
+    _Alignas(PIPE_CACHE_LINE) _Atomic uint32_t head;  /* published by the producer */
+    uint32_t  pending;                                /* producer: reserved but not yet published */
+    uint32_t  cachedTail;                             /* producer's last view of tail */
+    _Alignas(PIPE_CACHE_LINE) _Atomic uint32_t tail;  /* published by the consumer */
+    uint32_t  cachedHead;                             /* consumer's last view of head */
+    _Alignas(PIPE_CACHE_LINE) _Atomic int sleeping;   /* consumer is blocked on wakeFd */
+    int       wakeFd;                                 /* eventfd the producer signals, may be shared */
+    _Alignas(PIPE_CACHE_LINE) pipeEvent events[PIPE_QUEUE_SIZE];
+} spscQueue;
+
+typedef struct {
+    const char* name;
+    int         lane;
+    pthread_t   tid;
+    _Atomic uint64_t events;
+    _Atomic uint64_t batches;
+    uint64_t    lastEvents;
+} pipeStage;
+
+//==================================================FUNCTION========================|
+//Name:					spscReserve 																												|
+//Params:				spscQueue*	q		The queue to produce into.										|
+//Returns:			pipeEvent*			The next free event, or NULL if the queue is full.|
+//Outputs:			NONE																																|
+//Description:	This function hands the producer an event to fill in place. It is	| 
+//							not visible to the consumer until spscCommit is called.						|
+//==================================================================================|
+static inline pipeEvent *spscReserve(spscQueue *q)
+{
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed) + q->pending;
+
+    if (head - q->cachedTail >= PIPE_QUEUE_SIZE) {
+        q->cachedTail = atomic_load_explicit(&q->tail, memory_order_acquire);
+        if (head - q->cachedTail >= PIPE_QUEUE_SIZE) return NULL;
+    }
+
+    q->pending++;
+    return &q->events[head & (PIPE_QUEUE_SIZE - 1)];
+}
+
+//==================================================FUNCTION========================|
+//Name:					spscCommit 																													|
+//Params:				spscQueue*	q		The queue to publish to.											|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function publishes every reserved event to the consumer at once.| 
+//							A consumer blocked in spscSleep is woken through its eventfd; a busy	|
+//							one costs the producer only a fence and a load.										|
+//==================================================================================|
+static inline void spscCommit(spscQueue *q)
+{
+    uint64_t wake = 1;
+
+    if (q->pending == 0) return;
+
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    atomic_store_explicit(&q->head, head + q->pending, memory_order_release);
+    q->pending = 0;
+
+    // Pairs with the fence in spscSleep: either the consumer sees the new head
+    // or this sees it asleep, never neither
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&q->sleeping, memory_order_relaxed)) {
+        write(q->wakeFd, &wake, sizeof(wake));
+    }
+}
+
+//==================================================FUNCTION========================|
+//Name:					spscPeek 																														|
+//Params:				spscQueue*	q		The queue to consume from.										|
+//							uint32_t		max	The largest batch wanted.											|
+//Returns:			uint32_t				The number of events ready, at most max.					|
+//Outputs:			NONE																																|
+//Description:	This function reports how many events can be read with spscAt.			| 
+//==================================================================================|
+static inline uint32_t spscPeek(spscQueue *q, uint32_t max)
+{
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    uint32_t avail = q->cachedHead - tail;
+
+    if (avail == 0) {
+        q->cachedHead = atomic_load_explicit(&q->head, memory_order_acquire);
+        avail = q->cachedHead - tail;
+    }
+    return avail < max ? avail : max;
+}
+
+//==================================================FUNCTION========================|
+//Name:					spscAt 																															|
+//Params:				spscQueue*	q		The queue to consume from.										|
+//							uint32_t		i		The position within the batch.								|
+//Returns:			pipeEvent*			The i-th unread event.														|
+//Outputs:			NONE																																|
+//Description:	This function gives the consumer access to an event in place.				| 
+//==================================================================================|
+static inline pipeEvent *spscAt(spscQueue *q, uint32_t i)
+{
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    return &q->events[(tail + i) & (PIPE_QUEUE_SIZE - 1)];
+}
+
+//==================================================FUNCTION========================|
+//Name:					spscSleep 																													|
+//Params:				spscQueue*	q[]	The queues a consumer drains, sharing one wakeFd.	|
+//							int					n		The number of queues.													|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function blocks an idle consumer until one of its producers		| 
+//							commits. The queues are checked again after the consumer has		|
+//							announced it is sleeping, so a commit in between is not missed.		|
+//==================================================================================|
+static inline void spscSleep(spscQueue *q[], int n)
+{
+    uint64_t wake;
+    int i, ready = 0;
+
+    for (i = 0; i < n; i++) {
+        atomic_store_explicit(&q[i]->sleeping, 1, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_seq_cst);
+
+    for (i = 0; i < n && !ready; i++) {
+        ready = spscPeek(q[i], 1) > 0;
+    }
+    if (!ready) {
+        read(q[0]->wakeFd, &wake, sizeof(wake));
+    }
+
+    for (i = 0; i < n; i++) {
+        atomic_store_explicit(&q[i]->sleeping, 0, memory_order_relaxed);
+    }
+}
+
+//==================================================FUNCTION========================|
+//Name:					spscRelease 																												|
+//Params:				spscQueue*	q		The queue to consume from.										|
+//							uint32_t		n		The number of events finished with.						|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function returns a consumed batch to the producer.							| 
+//==================================================================================|
+static inline void spscRelease(spscQueue *q, uint32_t n)
+{
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    atomic_store_explicit(&q->tail, tail + n, memory_order_release);
+}
+
+#endif
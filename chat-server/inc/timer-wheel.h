@@ -0,0 +1,119 @@
+/*
+*	FILE:					timer-wheel.h
+*	ASSIGNMENT:		The "Can We Talk?" System
+*	PROGRAMMERS:	Quang Minh Vu
+*	DESCRIPTION:	This file holds the hashed timer wheel the ingest stage uses for per-connection
+*								heartbeat and idle deadlines. Timers are intrusive nodes, so insert and cancel
+*								are O(1) list operations, and each tick only visits one bucket. Deadlines
+*								further out than the wheel's span simply stay in their bucket for more laps.
+*/
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define WHEEL_SLOTS     1024            /* must be a power of two */
+#define TIMER_TICK_MS   100
+
+typedef struct timerNode {
+    struct timerNode* next;
+    struct timerNode* prev;             /* NULL while the timer is not armed */
+    uint64_t          expires;          /* absolute tick */
+} timerNode;
+
+typedef struct {
+    timerNode buckets[WHEEL_SLOTS];     /* list heads */
+    uint64_t  now;                      /* last tick processed */
+} timerWheel;
+
+//==================================================FUNCTION========================|
+//Name:					wheelInit 																													|
+//Params:				timerWheel*	w		The wheel to clear.														|
+//							uint64_t		now	The current tick.															|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function empties every bucket.																	| 
+//==================================================================================|
+static inline void wheelInit(timerWheel *w, uint64_t now)
+{
+    for (int i = 0; i < WHEEL_SLOTS; i++) {
+        w->buckets[i].next = &w->buckets[i];
+        w->buckets[i].prev = &w->buckets[i];
+    }
+    w->now = now;
+}
+
+//==================================================FUNCTION========================|
+//Name:					wheelCancel 																												|
+//Params:				timerNode*	node	The timer to disarm.												|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function removes a timer from its bucket, if it is armed.			| 
+//==================================================================================|
+static inline void wheelCancel(timerNode *node)
+{
+    if (node->prev == NULL) return;
+
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next = node->prev = NULL;
+}
+
+//==================================================FUNCTION========================|
+//Name:					wheelInsert 																												|
+//Params:				timerWheel*	w				The wheel.																|
+//							timerNode*	node		The timer to arm, re-arming it if needed.	|
+//							uint64_t		expires	The tick it should fire on.								|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function arms a timer. A deadline already passed fires on the	| 
+//							next tick.																												|
+//==================================================================================|
+static inline void wheelInsert(timerWheel *w, timerNode *node, uint64_t expires)
+{
+    timerNode *head;
+
+    wheelCancel(node);
+    if (expires <= w->now) expires = w->now + 1;
+
+    head = &w->buckets[expires & (WHEEL_SLOTS - 1)];
+    node->expires = expires;
+    node->next = head;
+    node->prev = head->prev;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+//==================================================FUNCTION========================|
+//Name:					wheelExpire 																												|
+//Params:				timerWheel*	w			The wheel.																	|
+//							uint64_t		tick	The current tick.														|
+//Returns:			timerNode*				The expired timers, chained through next.			|
+//Outputs:			NONE																																|
+//Description:	This function advances the wheel to tick and disarms every timer		| 
+//							that came due on the way. The caller may re-arm them.							|
+//==================================================================================|
+static inline timerNode *wheelExpire(timerWheel *w, uint64_t tick)
+{
+    timerNode *expired = NULL;
+    timerNode *head, *node, *next;
+
+    while (w->now < tick) {
+        w->now++;
+        head = &w->buckets[w->now & (WHEEL_SLOTS - 1)];
+
+        for (node = head->next; node != head; node = next) {
+            next = node->next;
+            if (node->expires <= w->now) {
+                wheelCancel(node);
+                node->next = expired;
+                expired = node;
+            }
+        }
+    }
+    return expired;
+}
+
+#endif
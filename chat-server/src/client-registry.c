@@ -0,0 +1,219 @@
+/*
+*	FILE:					client-registry.c
+*	ASSIGNMENT:		The "Can We Talk?" System
+*	PROGRAMMERS:	Quang Minh Vu
+*	DESCRIPTION:	This file holds the functions for the client registry. Readers announce the
+*								global epoch they entered at and walk the current memberSet with no locks.
+*								Writers (holding userList_mutex) publish a new copy and retire the old one,
+*								which is freed once every reader has moved past the epoch it was retired in.
+*/
+
+#include "../inc/chat-server.h"
+
+//===GLOBALS===//
+static _Atomic(memberSet *) currentSet = NULL;
+static _Atomic uint64_t globalEpoch = 1;
+static readerRecord readers[MAX_READERS];
+static _Atomic int numReaders = 0;
+static __thread int readerIndex = -1;
+
+// Writer-side state, protected by userList_mutex
+static struct {
+    memberSet* set;
+    uint64_t   epoch;
+} retired[MAX_RETIRED];
+static int numRetired = 0;
+
+//==================================================FUNCTION========================|
+//Name:					registryInit 																												|
+//Params:				NONE																																|
+//Returns:			int					0 on success, -1 if the first snapshot could not be made.|
+//Outputs:			NONE																																|
+//Description:	This function publishes the initial, empty member set.							| 
+//==================================================================================|
+int registryInit(void)
+{
+    memberSet *set = calloc(1, sizeof(memberSet));
+
+    if (set == NULL) return -1;
+    atomic_store(&currentSet, set);
+    return 0;
+}
+
+//==================================================FUNCTION========================|
+//Name:					registryEnter 																											|
+//Params:				NONE																																|
+//Returns:			memberSet*	The current snapshot, valid until registryExit.				|
+//Outputs:			NONE																																|
+//Description:	This function starts a read section for the calling thread. Each		| 
+//							thread claims its reader record the first time it calls this.			|
+//==================================================================================|
+const memberSet *registryEnter(void)
+{
+    if (readerIndex < 0) {
+        readerIndex = atomic_fetch_add(&numReaders, 1);
+        if (readerIndex >= MAX_READERS) {
+            fprintf(stderr, "client registry: more than %d reader threads\n", MAX_READERS);
+            abort();
+        }
+    }
+
+    atomic_store(&readers[readerIndex].epoch, atomic_load(&globalEpoch));
+    return atomic_load(&currentSet);
+}
+
+//==================================================FUNCTION========================|
+//Name:					registryExit 																												|
+//Params:				NONE																																|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function ends the calling thread's read section.								| 
+//==================================================================================|
+void registryExit(void)
+{
+    atomic_store_explicit(&readers[readerIndex].epoch, 0, memory_order_release);
+}
+
+//==================================================FUNCTION========================|
+//Name:					oldestReader 																												|
+//Params:				NONE																																|
+//Returns:			uint64_t		The lowest epoch a reader is inside, or UINT64_MAX.		|
+//Outputs:			NONE																																|
+//Description:	This function finds how far back a reader could still be looking.		| 
+//==================================================================================|
+static uint64_t oldestReader(void)
+{
+    uint64_t oldest = UINT64_MAX;
+    uint64_t epoch;
+    int count = atomic_load(&numReaders);
+
+    if (count > MAX_READERS) count = MAX_READERS;
+    for (int i = 0; i < count; i++) {
+        epoch = atomic_load(&readers[i].epoch);
+        if (epoch != 0 && epoch < oldest) oldest = epoch;
+    }
+    return oldest;
+}
+
+//==================================================FUNCTION========================|
+//Name:					reclaimRetired 																											|
+//Params:				NONE																																|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function frees every retired set no reader can still hold.			| 
+//							The caller must hold userList_mutex.															|
+//==================================================================================|
+static void reclaimRetired(void)
+{
+    uint64_t oldest = oldestReader();
+    int kept = 0;
+
+    for (int i = 0; i < numRetired; i++) {
+        if (retired[i].epoch <= oldest) {
+            free(retired[i].set);
+        } else {
+            retired[kept++] = retired[i];
+        }
+    }
+    numRetired = kept;
+}
+
+//==================================================FUNCTION========================|
+//Name:					publishSet 																													|
+//Params:				memberSet*	set		The new snapshot.															|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function swaps in a new snapshot and retires the old one.			| 
+//							The caller must hold userList_mutex.															|
+//==================================================================================|
+static void publishSet(memberSet *set)
+{
+    memberSet *old = atomic_exchange(&currentSet, set);
+    uint64_t epoch = atomic_fetch_add(&globalEpoch, 1) + 1;
+
+    reclaimRetired();
+    if (numRetired == MAX_RETIRED) {
+        registrySynchronize();
+        reclaimRetired();
+    }
+
+    retired[numRetired].set = old;
+    retired[numRetired].epoch = epoch;
+    numRetired++;
+}
+
+//==================================================FUNCTION========================|
+//Name:					registryAdd 																												|
+//Params:				userInfo*	slots[]		The newly claimed slots.											|
+//							int				count			The number of slots.													|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function publishes a snapshot that includes a whole accept			| 
+//							batch. The caller must hold userList_mutex.												|
+//==================================================================================|
+void registryAdd(userInfo *slots[], int count)
+{
+    const memberSet *old = atomic_load(&currentSet);
+    memberSet *set;
+
+    if (count == 0) return;
+    while ((set = malloc(sizeof(memberSet))) == NULL) {
+        sched_yield();
+    }
+
+    memcpy(set, old, sizeof(memberSet));
+    for (int i = 0; i < count && set->count < MAX_CLIENTS; i++) {
+        set->members[set->count] = slots[i];
+        set->sockets[set->count] = slots[i]->socket;
+        set->count++;
+    }
+
+    publishSet(set);
+}
+
+//==================================================FUNCTION========================|
+//Name:					registryRemove 																											|
+//Params:				userInfo*	slot		The slot of the client that is leaving.				|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function publishes a snapshot without the client. Readers may	| 
+//							still hold its socket until registrySynchronize returns.					|
+//							The caller must hold userList_mutex.															|
+//==================================================================================|
+void registryRemove(userInfo *slot)
+{
+    const memberSet *old = atomic_load(&currentSet);
+    memberSet *set;
+
+    while ((set = malloc(sizeof(memberSet))) == NULL) {
+        sched_yield();
+    }
+
+    set->count = 0;
+    for (int i = 0; i < old->count; i++) {
+        if (old->members[i] != slot) {
+            set->members[set->count] = old->members[i];
+            set->sockets[set->count] = old->sockets[i];
+            set->count++;
+        }
+    }
+
+    publishSet(set);
+}
+
+//==================================================FUNCTION========================|
+//Name:					registrySynchronize 																								|
+//Params:				NONE																																|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function waits until every read section that started before		| 
+//							the call has ended, so nothing still uses a removed member.				|
+//==================================================================================|
+void registrySynchronize(void)
+{
+    uint64_t epoch = atomic_fetch_add(&globalEpoch, 1) + 1;
+
+    while (oldestReader() < epoch) {
+        sched_yield();
+    }
+}
@@ -10,26 +10,152 @@
 
 //===GLOBALS===//
 static int	numClients = 0;
-userInfo	userList[10];
-struct 		sockaddr_in addr;
-socklen_t 	addr_len;
-char 		IP[INET_ADDRSTRLEN];
+userInfo	userList[MAX_CLIENTS];
 pthread_mutex_t userList_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t  slotFree_cond = PTHREAD_COND_INITIALIZER;
+chatRing*	broadcastRing = NULL;
+pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+FILE*		captureFile = NULL;
+struct		timespec captureStart;
+uint32_t	nextConnID = 0;
+volatile sig_atomic_t stopRequested = 0;
 
-int main (void)
+//===MULTICAST===//
+int			mcastSocket = -1;
+struct		sockaddr_in mcastGroup;
+pthread_mutex_t mcast_mutex = PTHREAD_MUTEX_INITIALIZER;	// every fan-out lane publishes
+uint32_t	mcastNextSeq = 0;			// guarded by mcast_mutex, like the history
+mcastFrame	mcastHistory[MCAST_HISTORY];
+
+//===PIPELINE===//
+int			numLanes = 1;
+int			ingestEpoll = -1;
+int			admitEvent = -1;				// wakes ingest when admitQueue has new clients
+spscQueue*	admitQueue;					// accept -> ingest
+spscQueue*	parseQueue[MAX_LANES];		// ingest -> parse
+spscQueue*	formatQueue[MAX_LANES];		// parse -> format
+spscQueue*	fanoutQueue[MAX_LANES];		// format -> fan-out
+pipeStage	stages[1 + 3 * MAX_LANES];
+int			numStages = 0;
+volatile sig_atomic_t statsRequested = 0;
+
+//===IDLE TIMERS===//
+timerWheel	idleWheel;					// owned by the ingest stage
+uint64_t	idleTicks = (IDLE_TIMEOUT_SEC * 1000) / TIMER_TICK_MS;
+uint64_t	heartbeatTicks = (IDLE_TIMEOUT_SEC * 1000) / TIMER_TICK_MS / 3;
+struct		timespec serverStart;
+
+//==================================================FUNCTION========================|
+//Name:					requestStats 																												|
+//Params:				int	sig		The signal received (SIGUSR1).													|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function asks the main loop to print the per-stage counters.		| 
+//==================================================================================|
+static void requestStats(int sig)
+{
+    (void)sig;
+    statsRequested = 1;
+}
+
+//==================================================FUNCTION========================|
+//Name:					requestStop 																												|
+//Params:				int	sig		The signal received (SIGINT or SIGTERM).								|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function asks the main loop to shut the server down cleanly.		| 
+//==================================================================================|
+static void requestStop(int sig)
+{
+    (void)sig;
+    stopRequested = 1;
+}
+
+//==================================================FUNCTION========================|
+//Name:					captureTime 																												|
+//Params:				NONE																																|
+//Returns:			uint64_t		Nanoseconds since the capture started.								|
+//Outputs:			NONE																																|
+//Description:	This function timestamps a capture record.													| 
+//==================================================================================|
+static uint64_t captureTime(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - captureStart.tv_sec) * 1000000000ull
+           + (now.tv_nsec - captureStart.tv_nsec);
+}
+
+int main (int argc, char *argv[])
 {
 	//===VARIABLES===//
-    int       server_socket, client_socket;
-    int       client_len;
-    struct 	  sockaddr_in client_addr, server_addr;
-    int       len, i;
-    pthread_t	tid[10];
-    int       whichClient;
-    char	  message[79];
+    int       server_socket, unix_socket;
+    struct 	  sockaddr_in server_addr;
+    struct    pollfd listeners[2];
+    struct    sigaction sa;
+    char      ringName[NAME_MAX] = "";
+    char      capturePath[PATH_MAX] = "";
+    char      unixPath[sizeof(((struct sockaddr_un *)0)->sun_path)] = UNIX_SOCKET_PATH;
+    int       lanes = 1;
+    int       status = 4;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "-shm", 4) == 0)
+        {
+            strncpy(ringName, argv[i] + 4, sizeof(ringName) - 1);
+        }
+        else if (strncmp(argv[i], "-lanes", 6) == 0)
+        {
+            lanes = atoi(argv[i] + 6);
+        }
+        else if (strncmp(argv[i], "-multicast", 10) == 0)
+        {
+            if (openMulticast(argv[i] + 10) < 0)
+            {
+                return 8;
+            }
+        }
+        else if (strncmp(argv[i], "-idle", 5) == 0)
+        {
+            idleTicks = (atoi(argv[i] + 5) * 1000ull) / TIMER_TICK_MS;
+            heartbeatTicks = idleTicks / 3;
+        }
+        else if (strncmp(argv[i], "-capture", 8) == 0)
+        {
+            strncpy(capturePath, argv[i] + 8, sizeof(capturePath) - 1);
+        }
+        else if (strncmp(argv[i], "-unix", 5) == 0)
+        {
+            // An empty path turns the local listener off
+            strncpy(unixPath, argv[i] + 5, sizeof(unixPath) - 1);
+        }
+    }
 
 	initializeArray();
+    clock_gettime(CLOCK_MONOTONIC, &serverStart);
+
+    if (registryInit() < 0)
+    {
+        return 5;
+    }
+
+    if (strlen(ringName) > 0 && (broadcastRing = ringCreate(ringName)) == NULL)
+    {
+        return 6;
+    }
 
-    if ((server_socket = socket(AF_INET, SOCK_STREAM, 0)) < 0) 
+    if (strlen(capturePath) > 0)
+    {
+        if ((captureFile = fopen(capturePath, "wb")) == NULL || captureWriteHeader(captureFile) < 0)
+        {
+            return 7;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &captureStart);
+    }
+
+    if ((server_socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) 
     {
         return 1;
     }
@@ -51,47 +177,271 @@ int main (void)
         return 2;
     }
 
-    if (listen(server_socket, 5) < 0) 
+    if (listen(server_socket, SOMAXCONN) < 0) 
     {
         close(server_socket);
         return 3;
     }
-  
-    //===MAIN LOOP===//
-    while (numClients < 10) 
+
+    // The local listener is optional; TCP clients are served without it
+    unix_socket = -1;
+    if (strlen(unixPath) > 0 && (unix_socket = openUnixListener(unixPath)) < 0)
     {
-        client_len = sizeof(client_addr);
-        if ((client_socket = accept(server_socket,(struct sockaddr *)&client_addr, &client_len)) < 0) 
+        fprintf(stderr, "continuing without the local listener on %s\n", unixPath);
+    }
+
+    if (startPipeline(lanes) < 0)
+    {
+        close(server_socket);
+        if (unix_socket >= 0)
         {
-            return 4;
+            close(unix_socket);
+            unlink(unixPath);
         }
+        return 5;
+    }
 
-        if (inet_ntop(AF_INET, &client_addr.sin_addr, IP, INET_ADDRSTRLEN) == NULL) {
-            exit(EXIT_FAILURE);
-        }
+    // SIGUSR1 dumps the per-stage throughput counters
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = requestStats;
+    sigaction(SIGUSR1, &sa, NULL);
 
+    // SIGINT and SIGTERM stop the server so the capture and socket file are cleaned up
+    sa.sa_handler = requestStop;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    listeners[0].fd = server_socket;
+    listeners[0].events = POLLIN;
+    listeners[1].fd = unix_socket;      // poll skips it when it is -1
+    listeners[1].events = POLLIN;
+  
+    //===MAIN LOOP===//
+    while (!stopRequested) 
+    {
+        // When the chat is full, leave new connections queued in the backlog
         pthread_mutex_lock(&userList_mutex);
-        updateArray(client_socket);
+        while (numClients >= MAX_CLIENTS && !stopRequested)
+        {
+            struct timespec wakeup;
+            clock_gettime(CLOCK_REALTIME, &wakeup);
+            wakeup.tv_sec += 1;
+            pthread_cond_timedwait(&slotFree_cond, &userList_mutex, &wakeup);
+        }
         pthread_mutex_unlock(&userList_mutex);
 
-        if (pthread_create(&(tid[(numClients-1)]), NULL, socketThread, (void *)&client_socket))
+        if (stopRequested) break;
+
+        if (poll(listeners, 2, -1) < 0)
+        {
+            if (errno != EINTR) break;
+            if (statsRequested)
+            {
+                statsRequested = 0;
+                printStageStats();
+            }
+            continue;
+        }
+
+        if ((listeners[0].revents & POLLIN) && acceptBatch(server_socket) < 0)
         {
-            return 5;
+            break;
         }
 
-        pthread_detach(tid[(numClients-1)]);
+        if ((listeners[1].revents & POLLIN) && acceptBatch(unix_socket) < 0)
+        {
+            break;
+        }
     }
+
+    if (stopRequested) status = 0;
     
-    //===CHAT FULL===//
-    for(i=0; i<10; i++)
+    //===CLEANUP===//
+    if (captureFile != NULL)
     {
-        pthread_join(tid[i], (void *)(&whichClient));
+        fflush(captureFile);
     }
-    
-    //===CLEANUP===//
-    pthread_mutex_destroy(&userList_mutex);
     close(server_socket);
-    return 0;
+    if (unix_socket >= 0)
+    {
+        // Only remove the socket file this server created
+        close(unix_socket);
+        unlink(unixPath);
+    }
+    if (mcastSocket >= 0)
+    {
+        close(mcastSocket);
+    }
+    if (broadcastRing != NULL)
+    {
+        shm_unlink(ringName);
+    }
+    return status;
+}
+
+//==================================================FUNCTION========================|
+//Name:           openUnixListener                                                  |
+//Params:         char* path              The filesystem path to listen on.         |
+//Returns:        int                     The non-blocking listening socket, or -1. |
+//Outputs:        NONE                                                              |
+//Description:    This function opens the AF_UNIX listener used by clients running  |
+//                on the same host. A socket file left behind by a dead server is   |
+//                replaced, but one that still accepts connections is left alone.   |
+//==================================================================================|
+int openUnixListener(const char *path)
+{
+    int    unix_socket, probe;
+    struct sockaddr_un unix_addr;
+
+    if ((unix_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0)
+    {
+        return -1;
+    }
+
+    memset(&unix_addr, 0, sizeof(unix_addr));
+    unix_addr.sun_family = AF_UNIX;
+    strncpy(unix_addr.sun_path, path, sizeof(unix_addr.sun_path) - 1);
+
+    // Probe the path first: only a refused connection proves the file is stale
+    if ((probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) >= 0)
+    {
+        if (connect(probe, (struct sockaddr *)&unix_addr, sizeof(unix_addr)) == 0)
+        {
+            fprintf(stderr, "another server is listening on %s\n", path);
+            close(probe);
+            close(unix_socket);
+            return -1;
+        }
+        if (errno == ECONNREFUSED)
+        {
+            unlink(path);
+        }
+        close(probe);
+    }
+
+    if (bind(unix_socket, (struct sockaddr *)&unix_addr, sizeof(unix_addr)) < 0 ||
+        listen(unix_socket, SOMAXCONN) < 0)
+    {
+        perror(path);
+        close(unix_socket);
+        return -1;
+    }
+
+    return unix_socket;
+}
+
+//==================================================FUNCTION========================|
+//Name:           acceptBatch                                                       |
+//Params:         int server_socket       The non-blocking TCP or AF_UNIX listener. |
+//Returns:        int                     Connections accepted, -1 if the listener  |
+//                                        itself is unusable (EBADF, EINVAL, ...).  |
+//Outputs:        NONE                                                              |
+//Description:    This function drains up to ACCEPT_BATCH pending connections, claims|
+//                their pool slots under a single lock and hands each to ingest.    |
+//                Ingest then watches the socket and arms its idle timer. Errors on |
+//                a single connection are skipped and running out of descriptors    |
+//                backs off for ACCEPT_BACKOFF_MS, so neither stops the server.     |
+//==================================================================================|
+int acceptBatch(int server_socket)
+{
+    int       sockets[ACCEPT_BATCH];
+    char      ips[ACCEPT_BATCH][INET_ADDRSTRLEN];
+    userInfo* slots[ACCEPT_BATCH];
+    pipeEvent* ev;
+    uint64_t  wake = 1;
+    struct    sockaddr_storage client_addr;
+    socklen_t client_len;
+    int       count = 0;
+    int       backoff = 0;
+    int       freeSlots, client_socket, i;
+
+    pthread_mutex_lock(&userList_mutex);
+    freeSlots = MAX_CLIENTS - numClients;
+    pthread_mutex_unlock(&userList_mutex);
+
+    if (freeSlots > ACCEPT_BATCH) freeSlots = ACCEPT_BATCH;
+
+    while (count < freeSlots)
+    {
+        client_len = sizeof(client_addr);
+        client_socket = accept4(server_socket, (struct sockaddr *)&client_addr, &client_len,
+                                SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_socket < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+
+            // The pending connection failed on its own, so try the next one
+            if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO ||
+                errno == ENETDOWN || errno == ENETUNREACH || errno == ENOPROTOOPT ||
+                errno == EHOSTDOWN || errno == EHOSTUNREACH || errno == ENONET ||
+                errno == EOPNOTSUPP || errno == ETIMEDOUT)
+            {
+                continue;
+            }
+
+            // Out of descriptors or kernel memory: hand over what was accepted
+            // and back off so the still-readable listener does not spin
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+            {
+                perror("accept4");
+                backoff = 1;
+                break;
+            }
+
+            // Anything else means the listener itself is broken
+            perror("accept4");
+            if (count > 0) break;
+            return -1;
+        }
+
+        // Local clients have no peer IP, so they are shown as "local"
+        if (client_addr.ss_family == AF_UNIX) {
+            strcpy(ips[count], "local");
+        } else if (inet_ntop(AF_INET, &((struct sockaddr_in *)&client_addr)->sin_addr,
+                             ips[count], INET_ADDRSTRLEN) == NULL) {
+            close(client_socket);
+            continue;
+        }
+
+        sockets[count++] = client_socket;
+    }
+
+    pthread_mutex_lock(&userList_mutex);
+    for (i = 0; i < count; i++)
+    {
+        slots[i] = updateArray(sockets[i], ips[i]);
+    }
+    registryAdd(slots, count);
+    pthread_mutex_unlock(&userList_mutex);
+
+    if (captureFile != NULL)
+    {
+        for (i = 0; i < count; i++)
+        {
+            captureWrite(captureFile, CAPTURE_OPEN, slots[i]->connID, captureTime(),
+                         slots[i]->ip, strlen(slots[i]->ip));
+        }
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        ev = stageReserve(admitQueue);
+        ev->type = EVENT_OPEN;
+        ev->slot = slots[i];
+    }
+
+    if (count > 0)
+    {
+        spscCommit(admitQueue);
+        write(admitEvent, &wake, sizeof(wake));
+    }
+
+    if (backoff)
+    {
+        usleep(ACCEPT_BACKOFF_MS * 1000);
+    }
+
+    return count;
 }
 
 //==================================================FUNCTION========================|
@@ -143,113 +493,787 @@ int parcelMessage(char* original, char* parceled[], int maxParcels) {
     return numParcels;
 }
 
-//==================================================FUNCTION==========================================================|
-//Name:					socketThread 																																													|
-//Params:				void*	clientSocket	The socket for the thread to connect to.																					|
-//Returns:			NONE 																																																	|
-//Outputs:			NONE																																																	|
-//Description:	This function represents a thread to handle the connection between the server and one of the clients.	| 
-//====================================================================================================================|
-void *socketThread(void *clientSocket)
+//==================================================FUNCTION========================|
+//Name:					startPipeline 																											|
+//Params:				int	lanes		The number of parse/format/fan-out lanes to run.				|
+//Returns:			int					0 on success, -1 if a queue or worker could not start.|
+//Outputs:			NONE																																|
+//Description:	This function creates the stage queues and starts one pinned worker	| 
+//							for ingest and a parse, format and fan-out worker per lane.				|
+//							Each client is served by lane (slot % lanes), keeping its order.		|
+//==================================================================================|
+int startPipeline(int lanes)
 {
-    //===VARIABLES===//
-    char buffer[BUFSIZ];
-    char message[79];
-    int sizeOfRead;
-    int numBytesRead;
-    int clSocket = *((int*)clientSocket);
-    char user_ip[INET_ADDRSTRLEN];
-    char userID[6] = "";
-    strcpy(user_ip, IP);
-    
-    memset(buffer, 0, BUFSIZ);
+    pipeStage *stage;
+    int i;
+
+    if (lanes < 1) lanes = 1;
+    if (lanes > MAX_LANES) lanes = MAX_LANES;
+    numLanes = lanes;
+
+    struct epoll_event wakeup;
+
+    if ((ingestEpoll = epoll_create1(EPOLL_CLOEXEC)) < 0) return -1;
+    if ((admitEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) return -1;
+
+    // A NULL data pointer marks the admit wake-up, every other event is a client slot
+    wakeup.events = EPOLLIN;
+    wakeup.data.ptr = NULL;
+    if (epoll_ctl(ingestEpoll, EPOLL_CTL_ADD, admitEvent, &wakeup) < 0) return -1;
+
+    // Ingest sleeps in epoll_wait, so the admit queue never needs its own wake-up
+    admitQueue = aligned_alloc(PIPE_CACHE_LINE, sizeof(spscQueue));
+    if (!admitQueue) return -1;
+    memset(admitQueue, 0, sizeof(spscQueue));
+    admitQueue->wakeFd = -1;
+    wheelInit(&idleWheel, currentTick());
 
-    int iAmClient = numClients;	 
+    for (i = 0; i < numLanes; i++) {
+        parseQueue[i] = aligned_alloc(PIPE_CACHE_LINE, sizeof(spscQueue));
+        formatQueue[i] = aligned_alloc(PIPE_CACHE_LINE, sizeof(spscQueue));
+        fanoutQueue[i] = aligned_alloc(PIPE_CACHE_LINE, sizeof(spscQueue));
+        if (!parseQueue[i] || !formatQueue[i] || !fanoutQueue[i]) return -1;
+        memset(parseQueue[i], 0, sizeof(spscQueue));
+        memset(formatQueue[i], 0, sizeof(spscQueue));
+        memset(fanoutQueue[i], 0, sizeof(spscQueue));
 
-    numBytesRead = read(clSocket, buffer, BUFSIZ);
-    if (numBytesRead <= 0) {
-        close(clSocket);
-        pthread_exit(NULL);
+        if ((parseQueue[i]->wakeFd = eventfd(0, EFD_CLOEXEC)) < 0) return -1;
+        if ((formatQueue[i]->wakeFd = eventfd(0, EFD_CLOEXEC)) < 0) return -1;
+        if ((fanoutQueue[i]->wakeFd = eventfd(0, EFD_CLOEXEC)) < 0) return -1;
     }
 
-    if (sscanf(buffer, "[%5[^]]] >>", userID) != 1) {
-        strcpy(userID, "????");
+    stages[numStages++] = (pipeStage){ .name = "ingest", .lane = 0 };
+    for (i = 0; i < numLanes; i++) {
+        stages[numStages++] = (pipeStage){ .name = "parse", .lane = i };
+    }
+    for (i = 0; i < numLanes; i++) {
+        stages[numStages++] = (pipeStage){ .name = "format", .lane = i };
+    }
+    for (i = 0; i < numLanes; i++) {
+        stages[numStages++] = (pipeStage){ .name = "fanout", .lane = i };
     }
 
-    while(strcmp(buffer, ">>bye<<") != 0)
-    {
-        if (strlen(buffer) > 0) {
-            //===MESSAGE FORMAT===//
-            strcpy(message, user_ip);
-            strcat(message, " ");
-            strcat(message, buffer);
-            strcat(message, " ");
+    for (i = 0; i < numStages; i++) {
+        stage = &stages[i];
+        void *(*worker)(void *) = ingestStage;
+        if (strcmp(stage->name, "parse") == 0) worker = parseStage;
+        else if (strcmp(stage->name, "format") == 0) worker = formatStage;
+        else if (strcmp(stage->name, "fanout") == 0) worker = fanoutStage;
+
+        if (pthread_create(&stage->tid, NULL, worker, stage)) return -1;
+        pthread_detach(stage->tid);
+        pinThread(stage->tid, i);
+    }
+
+    return 0;
+}
+
+//==================================================FUNCTION========================|
+//Name:					pinThread 																													|
+//Params:				pthread_t	tid		The worker to pin.														|
+//							int				cpu		The worker's index, wrapped onto the online CPUs.|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function pins a stage worker to one CPU so it keeps its cache.	| 
+//==================================================================================|
+void pinThread(pthread_t tid, int cpu)
+{
+    cpu_set_t set;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
 
+    if (cpus < 1) return;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu % cpus, &set);
+    pthread_setaffinity_np(tid, sizeof(set), &set);
+}
+
+//==================================================FUNCTION========================|
+//Name:					stageReserve 																												|
+//Params:				spscQueue*	q		The downstream queue.													|
+//Returns:			pipeEvent*			A free event in the queue.												|
+//Outputs:			NONE																																|
+//Description:	This function waits for room in a full downstream queue, first			| 
+//							publishing what is pending so the consumer can drain it.					|
+//==================================================================================|
+pipeEvent *stageReserve(spscQueue *q)
+{
+    pipeEvent *ev;
+    int idleSpins = 0;
+
+    while ((ev = spscReserve(q)) == NULL) {
+        spscCommit(q);
+        stageBackoff(&idleSpins);
+    }
+    return ev;
+}
+
+//==================================================FUNCTION========================|
+//Name:					stageBackoff 																												|
+//Params:				int*	idleSpins	The number of failed attempts in a row.						|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function spins briefly while a downstream queue is full, then	| 
+//							sleeps for PIPE_IDLE_US. The consumer of a full queue is busy, so	|
+//							it only has to be given the CPU, not woken.												|
+//==================================================================================|
+void stageBackoff(int *idleSpins)
+{
+    if (++(*idleSpins) < PIPE_SPIN_LIMIT) {
+        sched_yield();
+    } else {
+        usleep(PIPE_IDLE_US);
+    }
+}
+
+//==================================================FUNCTION========================|
+//Name:					stageIdle 																													|
+//Params:				spscQueue*	in[]			The queues the stage drains.								|
+//							int					numIn			The number of queues.												|
+//							int*				idleSpins	The number of empty polls in a row.					|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function spins briefly when a stage has nothing to do, so a		| 
+//							burst keeps its latency, then blocks on the queues' eventfd until	|
+//							a producer commits. An idle server costs no CPU and no wake-ups.	|
+//==================================================================================|
+void stageIdle(spscQueue *in[], int numIn, int *idleSpins)
+{
+    if (++(*idleSpins) < PIPE_SPIN_LIMIT) {
+        sched_yield();
+    } else {
+        spscSleep(in, numIn);
+        *idleSpins = 0;
+    }
+}
+
+//==================================================FUNCTION========================|
+//Name:					currentTick 																												|
+//Params:				NONE																																|
+//Returns:			uint64_t		Timer wheel ticks since the server started.						|
+//Outputs:			NONE																																|
+//Description:	This function converts the monotonic clock into wheel ticks.				| 
+//==================================================================================|
+uint64_t currentTick(void)
+{
+    struct timespec now;
+    uint64_t ms;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ms = (uint64_t)(now.tv_sec - serverStart.tv_sec) * 1000
+         + (now.tv_nsec - serverStart.tv_nsec) / 1000000;
+    return ms / TIMER_TICK_MS;
+}
+
+//==================================================FUNCTION========================|
+//Name:					ingestClose 																												|
+//Params:				userInfo*	slot	The client that has gone away or timed out.		|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function stops watching a client and sends a close down its		| 
+//							lane; fan-out frees the slot once earlier messages are out.				|
+//==================================================================================|
+void ingestClose(userInfo *slot)
+{
+    pipeEvent *ev = stageReserve(parseQueue[(int)(slot - userList) % numLanes]);
+
+    epoll_ctl(ingestEpoll, EPOLL_CTL_DEL, slot->socket, NULL);
+    wheelCancel(&slot->timer);
+
+    ev->type = EVENT_CLOSE;
+    ev->slot = slot;
+
+    if (captureFile != NULL) {
+        captureWrite(captureFile, CAPTURE_CLOSE, slot->connID, captureTime(), NULL, 0);
+    }
+}
+
+//==================================================FUNCTION========================|
+//Name:					admitClients 																												|
+//Params:				NONE																																|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function takes newly accepted clients from the accept loop,		| 
+//							starts watching their sockets and arms their heartbeat timers.		|
+//							In multicast mode it also has fan-out tell them the group.				|
+//==================================================================================|
+void admitClients(void)
+{
+    struct epoll_event event;
+    userInfo *slot;
+    uint64_t wake;
+    uint32_t n, i;
+
+    read(admitEvent, &wake, sizeof(wake));
+
+    while ((n = spscPeek(admitQueue, PIPE_BATCH)) > 0) {
+        for (i = 0; i < n; i++) {
+            slot = spscAt(admitQueue, i)->slot;
+            slot->lastActive = idleWheel.now;
+            slot->pingSent = 0;
+
+            event.events = EPOLLIN;
+            event.data.ptr = slot;
+            if (epoll_ctl(ingestEpoll, EPOLL_CTL_ADD, slot->socket, &event) < 0) {
+                ingestClose(slot);
+                continue;
+            }
+
+            if (idleTicks > 0) {
+                wheelInsert(&idleWheel, &slot->timer, idleWheel.now + heartbeatTicks);
+            }
+
+            // Offer the multicast group; the client subscribes once it has joined
+            if (mcastSocket >= 0) {
+                pipeEvent *ev = stageReserve(parseQueue[(int)(slot - userList) % numLanes]);
+                ev->type = EVENT_ANNOUNCE;
+                ev->slot = slot;
+            }
+        }
+        spscRelease(admitQueue, n);
+    }
+}
+
+//==================================================FUNCTION========================|
+//Name:					expireIdle 																													|
+//Params:				NONE																																|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function advances the idle wheel. A client silent for a third	| 
+//							of the idle timeout is sent a heartbeat ping; one still silent at	|
+//							the full timeout is treated as dead and closed.										|
+//==================================================================================|
+void expireIdle(void)
+{
+    timerNode *node, *next;
+    userInfo *slot;
+    uint64_t idle;
+    pipeEvent *ev;
+
+    for (node = wheelExpire(&idleWheel, currentTick()); node != NULL; node = next) {
+        next = node->next;
+        slot = (userInfo *)((char *)node - offsetof(userInfo, timer));
+        idle = idleWheel.now - slot->lastActive;
+
+        if (idle >= idleTicks) {
+            ingestClose(slot);
+        } else if (idle >= heartbeatTicks && !slot->pingSent) {
+            ev = stageReserve(parseQueue[(int)(slot - userList) % numLanes]);
+            ev->type = EVENT_PING;
+            ev->slot = slot;
+            slot->pingSent = 1;
+            wheelInsert(&idleWheel, node, slot->lastActive + idleTicks);
+        } else {
+            // Traffic arrived since the timer was armed; push the deadline out
+            wheelInsert(&idleWheel, node, slot->lastActive +
+                        (slot->pingSent ? idleTicks : heartbeatTicks));
+        }
+    }
+}
+
+//==================================================FUNCTION========================|
+//Name:					ingestStage 																												|
+//Params:				void*	arg		The stage's counters.																|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function reads every ready client socket and passes the raw		| 
+//							input, or a close, to the client's parse lane. Both are also				|
+//							recorded when the server was started with -capture<file>; control	|
+//							tokens are taken out first, so they never reach the capture.			|
+//							Reads only note the time of the client's last traffic; the idle	|
+//							timers catch up lazily when they fire, once per TIMER_TICK_MS.		|
+//							It also flushes outbound queues once their sockets are writable		|
+//							and, in multicast mode, announces the sequence every tick.				|
+//==================================================================================|
+void *ingestStage(void *arg)
+{
+    pipeStage *stage = (pipeStage *)arg;
+    struct epoll_event ready[PIPE_BATCH];
+    pipeEvent *ev;
+    userInfo *slot;
+    int n, i, lane, numBytesRead;
+    int ticking = idleTicks > 0 || mcastSocket >= 0;
+
+    while (1) {
+        n = epoll_wait(ingestEpoll, ready, PIPE_BATCH, ticking ? TIMER_TICK_MS : -1);
+        if (n < 0) n = 0;
+
+        for (i = 0; i < n; i++) {
+            slot = (userInfo *)ready[i].data.ptr;
+            if (slot == NULL) {
+                admitClients();
+                continue;
+            }
+            lane = (int)(slot - userList) % numLanes;
+
+            // The socket has room again for output fan-out could not send
+            if (ready[i].events & EPOLLOUT) {
+                flushClient(slot);
+                if (!(ready[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) continue;
+            }
+
+            memset(slot->buffer, 0, BUFSIZ);
+            numBytesRead = read(slot->socket, slot->buffer, BUFSIZ - 1);
+            if (numBytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                continue;
+            }
+
+            if (numBytesRead <= 0) {
+                ingestClose(slot);
+                continue;
+            }
+
+            slot->lastActive = idleWheel.now;
+            slot->pingSent = 0;
+
+            // Control tokens come from the client's receive thread and can share
+            // a read with a chat line from its input thread
+            if ((numBytesRead = takeControl(slot, lane)) == 0) {
+                continue;
+            }
+
+            if (captureFile != NULL) {
+                captureWrite(captureFile, CAPTURE_DATA, slot->connID, captureTime(),
+                             slot->buffer, numBytesRead);
+            }
+
+            if (strcmp(slot->buffer, ">>bye<<") == 0) {
+                ingestClose(slot);
+                continue;
+            }
+
+            ev = stageReserve(parseQueue[lane]);
+            ev->slot = slot;
+            ev->type = EVENT_MESSAGE;
+            strncpy(ev->text, slot->buffer, PIPE_TEXT_SIZE - 1);
+            ev->text[PIPE_TEXT_SIZE - 1] = '\0';
+        }
+
+        if (idleTicks > 0) {
+            expireIdle();
+        }
+        if (mcastSocket >= 0) {
+            mcastAnnounce();
+        }
+
+        for (lane = 0; lane < numLanes; lane++) {
+            spscCommit(parseQueue[lane]);
+        }
+        if (n > 0) {
+            atomic_fetch_add_explicit(&stage->events, n, memory_order_relaxed);
+            atomic_fetch_add_explicit(&stage->batches, 1, memory_order_relaxed);
+        }
+    }
+
+    return NULL;
+}
+
+//==================================================FUNCTION========================|
+//Name:					takeControl 																												|
+//Params:				userInfo*	slot	The client whose read is in slot->buffer.				|
+//							int				lane	The client's parse lane.												|
+//Returns:			int						The length of the chat input left in the buffer.	|
+//Outputs:			NONE																																|
+//Description:	This function takes heartbeat and multicast control tokens out of a	| 
+//							read, wherever they landed, and passes subscriptions and resend		|
+//							requests down the lane. Heartbeat replies only prove the client is	|
+//							alive, which the caller has already noted.												|
+//==================================================================================|
+int takeControl(userInfo *slot, int lane)
+{
+    pipeEvent *ev;
+    uint32_t from, to;
+    char *found, *end;
+
+    stripToken(slot->buffer, HEARTBEAT_PONG);
+
+    if (stripToken(slot->buffer, MCAST_SUBSCRIBE) > 0 && mcastSocket >= 0) {
+        ev = stageReserve(parseQueue[lane]);
+        ev->type = EVENT_SUBSCRIBE;
+        ev->slot = slot;
+    }
+
+    while ((found = strstr(slot->buffer, MCAST_RESEND)) != NULL &&
+           (end = strstr(found, "<<")) != NULL) {
+        if (mcastSocket >= 0 && sscanf(found, MCAST_RESEND "%u %u<<", &from, &to) == 2) {
+            ev = stageReserve(parseQueue[lane]);
+            ev->type = EVENT_RESEND;
+            ev->slot = slot;
+            ev->seqFrom = from;
+            ev->seqTo = to;
+        }
+        memmove(found, end + 2, strlen(end + 2) + 1);
+    }
+
+    return (int)strlen(slot->buffer);
+}
+
+//==================================================FUNCTION========================|
+//Name:					stripToken 																													|
+//Params:				char*	buffer	The NUL-terminated input read from a client.				|
+//							char*	token		The control token to take out.											|
+//Returns:			int						The number of bytes removed.											|
+//Outputs:			NONE																																|
+//Description:	This function removes every occurrence of a control token, wherever	| 
+//							it landed in the read, the way the client strips heartbeat pings.	|
+//==================================================================================|
+int stripToken(char *buffer, const char *token)
+{
+    size_t len = strlen(token);
+    int removed = 0;
+    char *found;
+
+    while ((found = strstr(buffer, token)) != NULL) {
+        memmove(found, found + len, strlen(found + len) + 1);
+        removed += len;
+    }
+    return removed;
+}
+
+//==================================================FUNCTION========================|
+//Name:					parseStage 																													|
+//Params:				void*	arg		The stage's counters and lane.											|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function takes the userID from a client's first message and		| 
+//							drops empty input before it reaches formatting.										|
+//==================================================================================|
+void *parseStage(void *arg)
+{
+    pipeStage *stage = (pipeStage *)arg;
+    spscQueue *in = parseQueue[stage->lane];
+    spscQueue *out = formatQueue[stage->lane];
+    pipeEvent *ev, *next;
+    uint32_t n, i;
+    int idleSpins = 0;
+
+    while (1) {
+        if ((n = spscPeek(in, PIPE_BATCH)) == 0) {
+            stageIdle(&in, 1, &idleSpins);
+            continue;
+        }
+        idleSpins = 0;
+
+        for (i = 0; i < n; i++) {
+            ev = spscAt(in, i);
+
+            if (ev->type == EVENT_MESSAGE) {
+                if (strlen(ev->text) == 0) continue;
+
+                if (!ev->slot->gotID) {
+                    if (sscanf(ev->text, "[%5[^]]] >>", ev->slot->userID) != 1) {
+                        strcpy(ev->slot->userID, "????");
+                    }
+                    ev->slot->gotID = 1;
+                }
+            }
+
+            next = stageReserve(out);
+            next->type = ev->type;
+            next->slot = ev->slot;
+            next->seqFrom = ev->seqFrom;
+            next->seqTo = ev->seqTo;
+            if (ev->type == EVENT_MESSAGE) {
+                strcpy(next->text, ev->text);
+            }
+        }
+
+        spscRelease(in, n);
+        spscCommit(out);
+        atomic_fetch_add_explicit(&stage->events, n, memory_order_relaxed);
+        atomic_fetch_add_explicit(&stage->batches, 1, memory_order_relaxed);
+    }
+
+    return NULL;
+}
+
+//==================================================FUNCTION========================|
+//Name:					formatStage 																												|
+//Params:				void*	arg		The stage's counters and lane.											|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function builds the sender's echo and parcels the message into	| 
+//							the broadcast frames for the other clients.												|
+//==================================================================================|
+void *formatStage(void *arg)
+{
+    pipeStage *stage = (pipeStage *)arg;
+    spscQueue *in = formatQueue[stage->lane];
+    spscQueue *out = fanoutQueue[stage->lane];
+    pipeEvent *ev, *next;
+    uint32_t n, i;
+    int idleSpins = 0;
+
+    while (1) {
+        if ((n = spscPeek(in, PIPE_BATCH)) == 0) {
+            stageIdle(&in, 1, &idleSpins);
+            continue;
+        }
+        idleSpins = 0;
+
+        for (i = 0; i < n; i++) {
+            ev = spscAt(in, i);
+            next = stageReserve(out);
+            next->type = ev->type;
+            next->slot = ev->slot;
+            next->seqFrom = ev->seqFrom;
+            next->seqTo = ev->seqTo;
+            next->numFrames = 0;
+
+            if (ev->type != EVENT_MESSAGE) continue;
+
+            //===MESSAGE FORMAT===//
             time_t t = time(NULL);
-            struct tm * time_info;
-            time_info = localtime(&t);  	
+            struct tm time_info;
+            localtime_r(&t, &time_info);
             char timeChar[10];
-            strftime(timeChar, sizeof(timeChar), "%H:%M:%S", time_info);
-            strcat(message, timeChar);
-
-            write(clSocket, message, strlen(message)); 
-
-            // Parcel and broadcast message to other clients
-            char* parcels[3]; // Max of 3 parcels (should be enough for 80 char limit)
-            int numParcels = parcelMessage(buffer, parcels, 3);
-            
-            for (int i = 0; i < numParcels; i++) {
-                char broadcast_message[BUFSIZ];
-                
-                char parsed_content[BUFSIZ];
-                char *content_start = strstr(parcels[i], ">>");
+            strftime(timeChar, sizeof(timeChar), "%H:%M:%S", &time_info);
+
+            // Cap the input so the address and timestamp always fit around it
+            snprintf(next->text, PIPE_TEXT_SIZE, "%s %.*s %s", ev->slot->ip,
+                     PIPE_TEXT_SIZE - INET_ADDRSTRLEN - 11, ev->text, timeChar);
+
+            // Parcel the message for the other clients
+            char* parcels[MAX_PARCELS];
+            int numParcels = parcelMessage(ev->text, parcels, MAX_PARCELS);
+
+            for (int j = 0; j < numParcels; j++) {
+                char *content_start = strstr(parcels[j], ">>");
                 if (content_start) {
-                    content_start += 3; 
-                    strcpy(parsed_content, content_start);
+                    content_start += 3;
                 } else {
-                    strcpy(parsed_content, parcels[i]);
+                    content_start = parcels[j];
                 }
-                
-                strcpy(broadcast_message, user_ip);
-                strcat(broadcast_message, " [");
-                strcat(broadcast_message, userID);
-                strcat(broadcast_message, "] >> ");
-                strcat(broadcast_message, parsed_content);
-                strcat(broadcast_message, " ");
-                
-                strftime(timeChar, sizeof(timeChar), "%H:%M:%S", time_info);
-                strcat(broadcast_message, timeChar);
-                
-                writeToClients(clSocket, broadcast_message);
-                free(parcels[i]);
+
+                snprintf(next->frames[j], PIPE_FRAME_SIZE, "%s [%s] >> %s %s",
+                         ev->slot->ip, ev->slot->userID, content_start, timeChar);
+                free(parcels[j]);
             }
+            next->numFrames = numParcels;
         }
-     
-        memset(buffer, 0, BUFSIZ);
-        numBytesRead = read(clSocket, buffer, BUFSIZ);
-        
-        if (numBytesRead <= 0) {
-            break;
+
+        spscRelease(in, n);
+        spscCommit(out);
+        atomic_fetch_add_explicit(&stage->events, n, memory_order_relaxed);
+        atomic_fetch_add_explicit(&stage->batches, 1, memory_order_relaxed);
+    }
+
+    return NULL;
+}
+
+//==================================================FUNCTION========================|
+//Name:					fanoutStage 																												|
+//Params:				void*	arg		The stage's counters and lane.											|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function drains one lane, echoing to the sender, broadcasting	|
+//							to everyone else and freeing the slot of a closed client. Each lane	|
+//							has its own fan-out, so broadcasts from different lanes overlap and	|
+//							walk the registry snapshot concurrently. Every write goes through	|
+//							the client's outbound queue, so a slow reader never holds up the		|
+//							other clients or, through the queues, ingest.											|
+//==================================================================================|
+void *fanoutStage(void *arg)
+{
+    pipeStage *stage = (pipeStage *)arg;
+    spscQueue *in = fanoutQueue[stage->lane];
+    pipeEvent *ev;
+    uint32_t n, i, seq;
+    int j, len;
+    int idleSpins = 0;
+    char control[64];
+
+    while (1) {
+        if ((n = spscPeek(in, PIPE_BATCH)) == 0) {
+            stageIdle(&in, 1, &idleSpins);
+            continue;
+        }
+        idleSpins = 0;
+
+        for (i = 0; i < n; i++) {
+            ev = spscAt(in, i);
+
+            if (ev->type == EVENT_CLOSE) {
+                releaseSlot(ev->slot);
+                continue;
+            }
+
+            if (ev->type == EVENT_PING) {
+                queueClient(ev->slot, ev->slot->socket, HEARTBEAT_PING, strlen(HEARTBEAT_PING));
+                continue;
+            }
+
+            if (ev->type == EVENT_ANNOUNCE) {
+                len = snprintf(control, sizeof(control), ">>mcast %s %d %u<<",
+                               inet_ntoa(mcastGroup.sin_addr), MULTICAST_PORT, ev->slot->connID);
+                queueClient(ev->slot, ev->slot->socket, control, len);
+                continue;
+            }
+
+            if (ev->type == EVENT_SUBSCRIBE) {
+                // Frames numbered from here on reach this client by multicast only.
+                // Taking the sequence lock orders this against every lane's publish.
+                pthread_mutex_lock(&mcast_mutex);
+                seq = mcastNextSeq;
+                atomic_store(&ev->slot->mcastFrom, seq);
+                pthread_mutex_unlock(&mcast_mutex);
+
+                len = snprintf(control, sizeof(control), ">>subscribed %u<<", seq);
+                queueClient(ev->slot, ev->slot->socket, control, len);
+                continue;
+            }
+
+            if (ev->type == EVENT_RESEND) {
+                mcastRepair(ev->slot, ev->seqFrom, ev->seqTo);
+                continue;
+            }
+
+            queueClient(ev->slot, ev->slot->socket, ev->text, strlen(ev->text));
+            for (j = 0; j < ev->numFrames; j++) {
+                seq = mcastSocket >= 0 ? mcastPublish(ev->slot, ev->frames[j]) : MCAST_NONE;
+                writeToClients(ev->slot->socket, ev->frames[j], seq);
+            }
         }
+
+        spscRelease(in, n);
+        atomic_fetch_add_explicit(&stage->events, n, memory_order_relaxed);
+        atomic_fetch_add_explicit(&stage->batches, 1, memory_order_relaxed);
     }
-    
-    //===SHUTDOWN===//
-    pthread_mutex_lock(&userList_mutex);
 
-    for (int i = 0; i < 10; i++) {
-        if (userList[i].socket == clSocket) {
-            userList[i].socket = -1;
-            memset(userList[i].ip, 0, 16);
-            numClients--;
-            break;
+    return NULL;
+}
+
+//==================================================FUNCTION========================|
+//Name:					printStageStats 																										|
+//Params:				NONE																																|
+//Returns:			NONE 																																|
+//Outputs:			One line per stage on stderr.																				|
+//Description:	This function reports each stage's events, batches and events per		| 
+//							second since the previous report.																	|
+//==================================================================================|
+void printStageStats(void)
+{
+    static struct timespec last;
+    struct timespec now;
+    double elapsed;
+    uint64_t events;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = (now.tv_sec - last.tv_sec) + (now.tv_nsec - last.tv_nsec) / 1e9;
+    if (last.tv_sec == 0) elapsed = 0;
+    last = now;
+
+    for (int i = 0; i < numStages; i++) {
+        events = atomic_load(&stages[i].events);
+        fprintf(stderr, "%-6s lane %d: %llu events, %llu batches, %.0f events/s\n",
+                stages[i].name, stages[i].lane,
+                (unsigned long long)events,
+                (unsigned long long)atomic_load(&stages[i].batches),
+                elapsed > 0 ? (events - stages[i].lastEvents) / elapsed : 0.0);
+        stages[i].lastEvents = events;
+    }
+}
+
+//==================================================FUNCTION========================|
+//Name:					queueClient 																												|
+//Params:				userInfo*	slot		The client to write to.												|
+//							int				socket	Its socket, as seen by the caller.						|
+//							char*			data		The bytes to be written.											|
+//							size_t		len			The number of bytes to be written.						|
+//Returns:			int							0 if the bytes were sent or queued, -1 if the		|
+//															client failed or its queue overflowed.				|
+//Outputs:			NONE																																|
+//Description:	This function never blocks. With nothing queued ahead it writes		|
+//							straight to the socket; whatever the socket does not take is kept	|
+//							in the client's outbound queue and ingest is asked to flush it on	|
+//							EPOLLOUT. A client that falls OUTBOUND_SIZE bytes behind is shut	|
+//							down instead of stalling the fan-out.															|
+//==================================================================================|
+int queueClient(userInfo *slot, int socket, const char *data, size_t len)
+{
+    struct epoll_event event;
+    ssize_t written;
+    size_t tail, chunk;
+    int status = 0;
+
+    pthread_mutex_lock(&slot->outLock);
+
+    if (slot->outLen == 0) {
+        written = send(socket, data, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            status = -1;
+        } else if (written > 0) {
+            data += written;
+            len -= written;
         }
     }
-    
-    pthread_mutex_unlock(&userList_mutex);
-    
-    close(clSocket);
 
-    pthread_exit((void *)iAmClient);
+    if (status == 0 && len > OUTBOUND_SIZE - slot->outLen) {
+        status = -1;
+    } else if (status == 0 && len > 0) {
+        tail = (slot->outHead + slot->outLen) % OUTBOUND_SIZE;
+        chunk = OUTBOUND_SIZE - tail < len ? OUTBOUND_SIZE - tail : len;
+        memcpy(slot->outBuf + tail, data, chunk);
+        memcpy(slot->outBuf, data + chunk, len - chunk);
+        slot->outLen += len;
+
+        if (!slot->outArmed) {
+            event.events = EPOLLIN | EPOLLOUT;
+            event.data.ptr = slot;
+            epoll_ctl(ingestEpoll, EPOLL_CTL_MOD, socket, &event);
+            slot->outArmed = 1;
+        }
+    }
+
+    pthread_mutex_unlock(&slot->outLock);
+
+    if (status < 0) {
+        shutdown(socket, SHUT_RDWR);
+    }
+    return status;
+}
+
+//==================================================FUNCTION========================|
+//Name:					flushClient 																												|
+//Params:				userInfo*	slot	The client whose socket became writable.				|
+//Returns:			NONE 																																|
+//Outputs:			NONE																																|
+//Description:	This function sends as much of the client's outbound queue as the		|
+//							socket takes, and stops watching EPOLLOUT once the queue is empty.	|
+//							Only ingest calls it, while the client is still being watched.		|
+//==================================================================================|
+void flushClient(userInfo *slot)
+{
+    struct epoll_event event;
+    ssize_t written = 0;
+    size_t chunk;
+
+    pthread_mutex_lock(&slot->outLock);
+
+    while (slot->outLen > 0) {
+        chunk = OUTBOUND_SIZE - slot->outHead < slot->outLen ? OUTBOUND_SIZE - slot->outHead : slot->outLen;
+        written = send(slot->socket, slot->outBuf + slot->outHead, chunk, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) break;
+
+        slot->outHead = (slot->outHead + written) % OUTBOUND_SIZE;
+        slot->outLen -= written;
+    }
+
+    // A broken socket is closed by the read side; its queued bytes are dropped
+    if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        slot->outLen = 0;
+    }
+
+    if (slot->outLen == 0 && slot->outArmed) {
+        slot->outHead = 0;
+        event.events = EPOLLIN;
+        event.data.ptr = slot;
+        epoll_ctl(ingestEpoll, EPOLL_CTL_MOD, slot->socket, &event);
+        slot->outArmed = 0;
+    }
+
+    pthread_mutex_unlock(&slot->outLock);
 }
 
 //==================================================FUNCTION==============================|
@@ -261,52 +1285,240 @@ void *socketThread(void *clientSocket)
 //========================================================================================|
 void initializeArray(void){
 	
-	for(int i = 0; i < 10; i++){
+	for(int i = 0; i < MAX_CLIENTS; i++){
 		userList[i].socket = -1;
-        memset(userList[i].ip, 0, 16);
+        memset(userList[i].ip, 0, INET_ADDRSTRLEN);
+        pthread_mutex_init(&userList[i].outLock, NULL);
 	}
 } 
 
 //==================================================FUNCTION================================|
 //Name:					updateArray 																																|
-//Params:				int	client_socket	the socket of the client that needs updating.							|
-//Returns:			NONE 																																				|
+//Params:				int		client_socket	the socket of the client that needs updating.						|
+//							char*	ip						the peer address of the client.													|
+//Returns:			userInfo*						the pool slot claimed for the client.										|
 //Outputs:			NONE																																				|
 //Description:	This function updates the userList array, adding socket and IP information.	| 
+//							The caller must hold userList_mutex and have checked that a slot is free.		|
 //==========================================================================================|
-void updateArray(int client_socket){
-	for(int i = 0; i < 10; i++){
+userInfo *updateArray(int client_socket, const char *ip){
+	for(int i = 0; i < MAX_CLIENTS; i++){
 		if (userList[i].socket == -1){
 			userList[i].socket = client_socket;
-            strcpy(userList[i].ip, IP);
+            strcpy(userList[i].ip, ip);
+            strcpy(userList[i].userID, "");
+            userList[i].connID = nextConnID++;
+            atomic_store(&userList[i].mcastFrom, MCAST_NONE);
+            userList[i].gotID = 0;
+            userList[i].outHead = 0;
+            userList[i].outLen = 0;
+            userList[i].outArmed = 0;
 			numClients++;
-			break;
+			return &userList[i];
 		}
 	}
+	return NULL;
+}
+
+//==================================================FUNCTION================================|
+//Name:					releaseSlot 																																|
+//Params:				userInfo*	slot	the pool slot of the client that disconnected.						|
+//Returns:			NONE 																																				|
+//Outputs:			NONE																																				|
+//Description:	This function returns the client's slot to the pool, waking the accept loop	| 
+//							if the chat was full. The client leaves the registry first; the slot is		|
+//							reused and its socket closed only after every broadcast that might still		|
+//							be queueing output for it has finished.																			|
+//==========================================================================================|
+void releaseSlot(userInfo *slot){
+    int clSocket;
+
+    pthread_mutex_lock(&userList_mutex);
+    registryRemove(slot);
+    pthread_mutex_unlock(&userList_mutex);
+
+    // Other lanes may still hold the old snapshot and write to this client
+    registrySynchronize();
+
+    pthread_mutex_lock(&userList_mutex);
+
+    clSocket = slot->socket;
+    slot->socket = -1;
+    memset(slot->ip, 0, INET_ADDRSTRLEN);
+    numClients--;
+    pthread_cond_signal(&slotFree_cond);
+
+    pthread_mutex_unlock(&userList_mutex);
+
+    close(clSocket);
 }
 
 //==================================================FUNCTION========================|
 //Name:					writeToClients 																											|
 //Params:				int*	clSocket	The socket of the client that sent the message.			|
 //							char	message		The message to be sent to clients.									|
+//							uint32_t	seq		Its multicast sequence number, or MCAST_NONE.			|
 //Returns:			NONE 																																|
 //Outputs:			NONE																																|
 //Description:	This function distributes a recieved message to all active clients.	| 
+//							A failed or hopelessly slow client is shut down by queueClient;		|
+//							its close comes back via ingest.																	|
+//							The frame is also published to the shared-memory ring, if enabled.	|
+//							The client list is read from the registry snapshot, without locking,|
+//							so the fan-out lanes broadcast side by side. A client subscribed to	|
+//							multicast is skipped for frames numbered from its subscription on.	|
 //==================================================================================|
-void writeToClients(int clSocket, char message[]){
-    pthread_mutex_lock(&userList_mutex);
+void writeToClients(int clSocket, char message[], uint32_t seq){
+    const memberSet *members;
+    size_t len = strlen(message);
+
+    // The ring is single-producer, so concurrent broadcasters take turns on it
+    if (broadcastRing != NULL) {
+        pthread_mutex_lock(&ring_mutex);
+        ringPublish(broadcastRing, message, len);
+        pthread_mutex_unlock(&ring_mutex);
+    }
+
+    members = registryEnter();
     
-    for (int i = 0; i < 10; i++){
-        if(userList[i].socket != -1 && userList[i].socket != clSocket){
-            int result = write(userList[i].socket, message, strlen(message));
-            if (result < 0) {
-                close(userList[i].socket);
-                userList[i].socket = -1;
-                memset(userList[i].ip, 0, 16);
-                numClients--;
-            }
+    for (int i = 0; i < members->count; i++){
+        if(members->sockets[i] != clSocket &&
+           (seq == MCAST_NONE || seq < atomic_load(&members->members[i]->mcastFrom))){
+            queueClient(members->members[i], members->sockets[i], message, len);
         }
     }
     
-    pthread_mutex_unlock(&userList_mutex);
-}
\ No newline at end of file
+    registryExit();
+}
+
+
+//==================================================FUNCTION========================|
+//Name:					openMulticast 																											|
+//Params:				char*	group	The IPv4 multicast group to publish broadcasts to.		|
+//Returns:			int					0 on success, -1 if the group or socket is unusable.	|
+//Outputs:			NONE																																|
+//Description:	This function opens the UDP socket for multicast mode. Loopback is	| 
+//							left on so clients on the server's own host receive it too.				|
+//==================================================================================|
+int openMulticast(const char *group)
+{
+    unsigned char loop = 1;
+    unsigned char ttl = 1;
+
+    memset(&mcastGroup, 0, sizeof(mcastGroup));
+    mcastGroup.sin_family = AF_INET;
+    mcastGroup.sin_port = htons(MULTICAST_PORT);
+    if (inet_pton(AF_INET, group, &mcastGroup.sin_addr) != 1 ||
+        !IN_MULTICAST(ntohl(mcastGroup.sin_addr.s_addr)))
+    {
+        return -1;
+    }
+
+    if ((mcastSocket = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0)
+    {
+        return -1;
+    }
+
+    if (setsockopt(mcastSocket, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0 ||
+        setsockopt(mcastSocket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0)
+    {
+        close(mcastSocket);
+        mcastSocket = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+//==================================================FUNCTION========================|
+//Name:					mcastPublish 																												|
+//Params:				userInfo*	sender	The client the frame came from.								|
+//							char*			frame		The broadcast frame.													|
+//Returns:			uint32_t	The sequence number the frame was given.									|
+//Outputs:			One "#<seq> <sender> <frame>" datagram to the group.								|
+//Description:	This function numbers a frame, keeps it for repairs and sends it		| 
+//							once for every subscribed listener. The lanes take turns on the		|
+//							sequence so numbers go out on the wire in order.									|
+//==================================================================================|
+uint32_t mcastPublish(userInfo *sender, const char *frame)
+{
+    mcastFrame *kept;
+    char packet[PIPE_FRAME_SIZE + 32];
+    uint32_t seq;
+    int len;
+
+    pthread_mutex_lock(&mcast_mutex);
+
+    seq = mcastNextSeq++;
+    kept = &mcastHistory[seq % MCAST_HISTORY];
+    kept->seq = seq;
+    kept->sender = sender->connID;
+    strncpy(kept->frame, frame, PIPE_FRAME_SIZE - 1);
+    kept->frame[PIPE_FRAME_SIZE - 1] = '\0';
+
+    len = snprintf(packet, sizeof(packet), "#%u %u %s", kept->seq, kept->sender, kept->frame);
+    sendto(mcastSocket, packet, len, 0, (struct sockaddr *)&mcastGroup, sizeof(mcastGroup));
+
+    pthread_mutex_unlock(&mcast_mutex);
+    return seq;
+}
+
+//==================================================FUNCTION========================|
+//Name:					mcastAnnounce 																											|
+//Params:				NONE																																|
+//Returns:			NONE 																																|
+//Outputs:			A ">>seq <next>" datagram to the group, at most once per tick.			|
+//Description:	This function tells listeners the next sequence number, so a lost	| 
+//							last frame is noticed even when nothing follows it. It announces a	|
+//							tick after new frames were published and every MCAST_ANNOUNCE_MS	|
+//							regardless. Only ingest calls it, on its timer tick.							|
+//==================================================================================|
+void mcastAnnounce(void)
+{
+    static uint64_t lastTick = 0;
+    static uint32_t lastSeq = 0;
+    uint64_t now = currentTick();
+    char packet[32];
+    int len;
+
+    if (now == lastTick) return;
+
+    // Sent under the sequence lock, so it never overtakes the frame before it
+    pthread_mutex_lock(&mcast_mutex);
+    if (mcastNextSeq != lastSeq || now - lastTick >= MCAST_ANNOUNCE_MS / TIMER_TICK_MS) {
+        len = snprintf(packet, sizeof(packet), ">>seq %u<<", mcastNextSeq);
+        sendto(mcastSocket, packet, len, 0, (struct sockaddr *)&mcastGroup, sizeof(mcastGroup));
+        lastSeq = mcastNextSeq;
+        lastTick = now;
+    }
+    pthread_mutex_unlock(&mcast_mutex);
+}
+
+//==================================================FUNCTION========================|
+//Name:					mcastRepair 																												|
+//Params:				userInfo*	slot	The client that missed datagrams.								|
+//							uint32_t	from	The first missing sequence number.							|
+//							uint32_t	to		The last missing sequence number.								|
+//Returns:			NONE 																																|
+//Outputs:			The missing frames, one per line, over the client's TCP socket.			|
+//Description:	This function repairs a gap from the history. Frames that have			| 
+//							already left the history are lost and are skipped.								|
+//==================================================================================|
+void mcastRepair(userInfo *slot, uint32_t from, uint32_t to)
+{
+    char packet[PIPE_FRAME_SIZE + 32];
+    mcastFrame *kept;
+    int len;
+
+    if (to - from >= MCAST_MAX_REPAIR) from = to - (MCAST_MAX_REPAIR - 1);
+
+    pthread_mutex_lock(&mcast_mutex);
+    for (uint32_t seq = from; seq != to + 1; seq++) {
+        kept = &mcastHistory[seq % MCAST_HISTORY];
+        if (kept->seq != seq || seq >= mcastNextSeq) continue;
+
+        len = snprintf(packet, sizeof(packet), "#%u %u %s\n", kept->seq, kept->sender, kept->frame);
+        if (queueClient(slot, slot->socket, packet, len) < 0) break;
+    }
+    pthread_mutex_unlock(&mcast_mutex);
+}